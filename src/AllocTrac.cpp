@@ -2,6 +2,98 @@
 
 #include "AllocTrac.h"
 #include <limits>
+#include <cstdio>
+#include <utility>
 
 std::atomic<size_t> AllocTrac::totalAlloc = 0;
+std::atomic<size_t> AllocTrac::peakAlloc = 0;
 size_t AllocTrac::maxAlloc = size_t(15) * 1024 * 1024 * 1024; // 15 GB
+std::array<std::atomic<size_t>, AllocTrac::N_CATEGORY> AllocTrac::catAlloc{};
+std::array<std::atomic<size_t>, AllocTrac::N_CATEGORY> AllocTrac::catPeak{};
+thread_local std::shared_ptr<AllocTrac::Scope> AllocTrac::threadScope;
+
+namespace {
+
+double MB(size_t bytes) { return bytes / (1024.0 * 1024); }
+
+} // namespace
+
+AllocTrac::Category AllocTrac::categoryOf(std::string_view name) {
+  static const std::pair<std::string_view, Category> table[] = {
+    {"bufData", DATA},
+    {"bufAux", DATA},
+    {"bufCheck", CHECK},
+    {"bufBase", CHECK},
+    {"bufCarry", CARRY},
+    {"bufReady", CARRY},
+    {"bufROE", CARRY},
+    {"bufStatsCarry", CARRY},
+    {"buf1", TEMP},
+    {"buf2", TEMP},
+    {"buf3", TEMP},
+    {"trig", TRIG},
+    {"weights", WEIGHTS},
+    {"proof", PROOF},
+  };
+
+  // Match on prefix, e.g. "proofBufVect" is PROOF.
+  for (auto [prefix, cat] : table) {
+    if (name.substr(0, prefix.size()) == prefix) { return cat; }
+  }
+  return OTHER;
+}
+
+const char* AllocTrac::categoryName(Category c) {
+  static const char* names[N_CATEGORY] = {"data", "check", "carry", "temp", "trig", "weights", "proof", "other"};
+  return names[c];
+}
+
+size_t AllocTrac::total(const Footprint& f) {
+  size_t sum = 0;
+  for (size_t x : f) { sum += x; }
+  return sum;
+}
+
+std::string AllocTrac::format(const Footprint& f) {
+  std::string s;
+  char buf[64];
+  for (int c = 0; c < N_CATEGORY; ++c) {
+    if (f[c]) {
+      snprintf(buf, sizeof(buf), "%s %s %.1f", s.empty() ? "" : ",", categoryName(Category(c)), MB(f[c]));
+      s += buf;
+    }
+  }
+  return s;
+}
+
+std::string AllocTrac::summary() {
+  std::string s;
+  char buf[96];
+  for (int c = 0; c < N_CATEGORY; ++c) {
+    if (catPeak[c]) {
+      snprintf(buf, sizeof(buf), "%s %s %.1f/%.1f", s.empty() ? "" : ",", categoryName(Category(c)), MB(catAlloc[c]), MB(catPeak[c]));
+      s += buf;
+    }
+  }
+  snprintf(buf, sizeof(buf), "GPU alloc %.1f MB (peak %.1f MB, max %.1f MB); MB now/peak:",
+           MB(totalAlloc), MB(peakAlloc), MB(maxAlloc));
+  return buf + s;
+}
+
+AllocTrac::TaskScope::TaskScope() : prev{std::exchange(threadScope, std::make_shared<Scope>())} {}
+
+AllocTrac::TaskScope::~TaskScope() {
+  std::shared_ptr<Scope> scope = std::exchange(threadScope, std::move(prev));
+  std::string s;
+  char buf[96];
+  size_t peak = 0;
+  for (int c = 0; c < N_CATEGORY; ++c) {
+    if (scope->peak[c]) {
+      snprintf(buf, sizeof(buf), "%s %s %.1f", s.empty() ? "" : ",", categoryName(Category(c)), MB(scope->peak[c]));
+      s += buf;
+      peak += scope->peak[c];
+    }
+  }
+  // The categories peak at different times, so their sum is an upper bound of the task's peak.
+  log("Task GPU alloc peak MB:%s (sum %.1f MB); %s\n", s.c_str(), MB(peak), summary().c_str());
+}
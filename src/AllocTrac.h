@@ -3,32 +3,80 @@
 #pragma once
 
 #include "log.h"
+#include <array>
 #include <atomic>
+#include <memory>
 #include <new>
+#include <string>
+#include <string_view>
 
 using namespace std::string_literals;
 
 class AllocTrac {
-  static std::atomic<size_t> totalAlloc;  
+public:
+  // The category of a device allocation, derived from the buffer name.
+  enum Category {DATA, CHECK, CARRY, TEMP, TRIG, WEIGHTS, PROOF, OTHER, N_CATEGORY};
+
+  // Bytes per category.
+  using Footprint = std::array<size_t, N_CATEGORY>;
+
+  static Category categoryOf(std::string_view bufName);
+  static const char* categoryName(Category c);
+
+  // The allocations made by the threads of one task (e.g. a worker's PRP test), whichever thread frees them.
+  struct Scope {
+    std::array<std::atomic<size_t>, N_CATEGORY> now{};
+    std::array<std::atomic<size_t>, N_CATEGORY> peak{};
+  };
+
+  // RAII: the allocations made by this thread during its lifetime go to a new Scope, which is summarized in the log
+  // on destruction (thus after the objects declared later, such as the task's Gpu, are gone).
+  class TaskScope {
+    std::shared_ptr<Scope> prev;
+  public:
+    TaskScope();
+    ~TaskScope();
+    TaskScope(const TaskScope&) = delete;
+    void operator=(const TaskScope&) = delete;
+  };
+
+private:
+  static thread_local std::shared_ptr<Scope> threadScope;
+
+  static std::atomic<size_t> totalAlloc;
+  static std::atomic<size_t> peakAlloc;
   static size_t maxAlloc;
+  static std::array<std::atomic<size_t>, N_CATEGORY> catAlloc;
+  static std::array<std::atomic<size_t>, N_CATEGORY> catPeak;
+
+  static void updatePeak(std::atomic<size_t>& peak, size_t value) {
+    size_t old = peak;
+    while (old < value && !peak.compare_exchange_weak(old, value)) {}
+  }
   
   size_t size{};
+  Category cat{OTHER};
+  std::shared_ptr<Scope> scope;
   
 public:
   AllocTrac() = default;
-  explicit AllocTrac(size_t size) : size(size) {
+  AllocTrac(size_t size, Category cat) : size(size), cat{cat} {
     if (size) {
       if (totalAlloc + size >= maxAlloc) {
         log("Reached GPU maxAlloc limit %.1f GB\n", float(maxAlloc) / (1024 * 1024 * 1024));
         throw std::bad_alloc();
       }
-      totalAlloc += size;
+      updatePeak(peakAlloc, totalAlloc += size);
+      updatePeak(catPeak[cat], catAlloc[cat] += size);
+      if ((scope = threadScope)) { updatePeak(scope->peak[cat], scope->now[cat] += size); }
       // log("alloc %lu total %lu limit %lu\n", size, size_t(totalAlloc), maxAlloc);
     }
   }
   ~AllocTrac() {
     if (size) {
       totalAlloc -= size;
+      catAlloc[cat] -= size;
+      if (scope) { scope->now[cat] -= size; }
       // log("release %lu total %lu limit %lu\n", size, size_t(totalAlloc), maxAlloc);
     }
   }
@@ -36,7 +84,7 @@ public:
   AllocTrac(const AllocTrac&) = delete;
   void operator=(const AllocTrac&) = delete;
 
-  AllocTrac(AllocTrac&& rhs) : size(rhs.size) { rhs.size = 0; }
+  AllocTrac(AllocTrac&& rhs) : size(rhs.size), cat{rhs.cat}, scope{std::move(rhs.scope)} { rhs.size = 0; }
   AllocTrac& operator=(AllocTrac&& rhs) {
     AllocTrac tmp{std::move(rhs)};
     swap(*this, tmp);
@@ -46,9 +94,21 @@ public:
   friend void swap(AllocTrac& a, AllocTrac& b) noexcept {
     using std::swap;
     swap(a.size, b.size);
+    swap(a.cat, b.cat);
+    swap(a.scope, b.scope);
   }
 
+  // Add this allocation to its category of f.
+  void addTo(Footprint& f) const { f[cat] += size; }
+
   static void setMaxAlloc(size_t m) { maxAlloc = m; }
+  static size_t maxAllocBytes() { return maxAlloc; }
   static size_t totalAllocBytes() { return totalAlloc; }
   static size_t availableBytes() { return maxAlloc - totalAlloc; }
+
+  // Current and peak allocation, per category.
+  static std::string summary();
+
+  static size_t total(const Footprint& f);
+  static std::string format(const Footprint& f);
 };
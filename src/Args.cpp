@@ -150,6 +150,15 @@ named "config.txt" in the prpll run directory.
                      but the errors are nevertheless costly computationally and better avoided.
                      A <value> of 1 extends the range by 0.1%% (and this would be acceptable); a value of 10
                      extends the range by 1%% (and this would be quite too much WRT errors).
+-bpw <file>        : load the FFT BPW limits from <file>, in the format of fftbpw.h (such as the ztune.txt
+                     written by -ztune, or the output of tools/fitbpw.py), overriding the built-in limits for
+                     the FFTs listed there. By default "fftbpw.txt" is loaded if present.
+-probe [<minZ>]    : at the start of each test, measure the ROE of the few cheapest tuned FFTs that are close to
+                     handling the exponent (up to 3%% beyond their tabulated limit), and use the fastest one
+                     that reaches Z >= <minZ> (default 28). Ignored when -fft is given.
+-migrate [<low>,<high>] : during a PRP test, watch the Z of the sampled ROE; at a verified checkpoint
+                     switch to the next larger tuned FFT when Z drops below <low>, and to a smaller one (still
+                     within its limits) when Z goes above <high>. Default 24,40. Ignored when -fft is given.
 
 -block <value>     : PRP block size, one of: 1000, 500, 200. Default 1000.
 -carry long|short  : force carry type. Short carry may be faster, but requires high bits/word.
@@ -164,7 +173,28 @@ named "config.txt" in the prpll run directory.
 -save <N>          : specify the number of savefiles to keep (default %u).
 -noclean           : do not delete data after the test is complete.
 -cache             : use binary kernel cache; useful with repeated use of -roeTune and -tune
+-fixedCheck        : use the fixed PRP check step of the block size. By default the check step adapts to the error
+                     history of the GPU (kept in error-history.txt): longer on clean hardware, shorter after errors.
+-roeSpike <max>    : when a sampled round-off error exceeds <max> (default 0.45), do the Gerbicz check right away
+                     instead of at the end of the check step. 0 disables. Without -roe the ROE is sampled on 4000
+                     iterations spread evenly over each check step, so this catches a rising ROE rather than a
+                     one-off error.
+-sumCheck          : check on every fused iteration that the sum of the FFT output is the square of the sum of the
+                     input (SUMINP/SUMOUT), read at every log point. On a mismatch PRP and CERT do the Gerbicz check
+                     right away, and LL rolls back to the last savefile. Slightly slower.
+-injectError <k>   : for testing the error recovery: corrupt the PRP data at iteration <k> with a word out of range,
+                     which causes a ROE spike on the next (sampled) iteration.
 -roe               : measure the Round-Off Error (Z) for more iterations (slow)
+-time              : profile the kernels, and the GPU idle time between them ranked by the host operation that caused
+                     it (e.g. readChecked, markerWait, backgroundWait); reported at every check.
+-metrics <file>    : write per-worker metrics (iteration, us/it, ETA, checks, ROE, queue stall time, bytes written)
+                     to <file> in the Prometheus text format, e.g. for the node_exporter textfile collector.
+-jsonlog <file>    : also append the progress, check and profile lines to <file> as JSON objects, one per line,
+                     with typed fields (event, worker, E, k, us/it, res64, ROE, check outcome).
+-control <socket>  : accept commands on the Unix-domain socket <socket>, one per line: "status", and "save", "stop",
+                     "pause", "resume", "reload" optionally followed by a worker number (default all workers).
+                     "stop" stops after a checkpoint like Ctrl-C; "reload" stops the current test after a checkpoint
+                     and picks again the best task from worktodo. E.g. echo status | socat - UNIX-CONNECT:<socket>
 
 -use <define>      : comma separated list of defines for configuring gpuowl.cl, such as:
   -use FAST_BARRIER: on AMD Radeon VII and older AMD GPUs, use a faster barrier(). Do not use
@@ -194,7 +224,23 @@ named "config.txt" in the prpll run directory.
 
   -use DEBUG       : enable asserts in OpenCL kernels (slow, developers)
 
--tune              : measures the speed of the FFTs specified in -fft <spec> to find the best FFT for each exponent.
+-tune [<modes>]     : measures the speed of the FFTs specified in -fft <spec> to find the best FFT for each exponent.
+                     By default the FFTs are raced: all are timed briefly, the clearly slower ones are dropped, and
+                     the rest are re-timed with more iterations until the choice is settled.
+                     <modes> is a comma-separated list of:
+                     full    : time every FFT with the same number of iterations (slow)
+                     compare : race, then do the full sweep, and report the differences
+                     work    : only the FFTs that could be used for the pending worktodo (including -pool),
+                               starting with those covering the most work
+                     nomodel : race all the FFTs; by default a cost model fitted to a few timed FFTs prunes
+                               those predicted to be clearly slow before racing
+
+-tuneBudget <secs> : stop re-timing close FFT candidates in -tune after this many seconds
+
+-tuneFresh         : re-measure everything in -tune, -ctune, -ztune and -carryTune. Otherwise the measurements
+                     recorded in tune-journal.txt for the same device, program version and driver are reused
+                     (e.g. when resuming an interrupted tune). The journal keeps all the measurements, and
+                     tools/fitbpw.py reads the -ztune ones.
 
 -ctune <configs>   : finds the best configuration for each FFT specified in -fft <spec>.
                      Prints the results in a form that can be incorporated in config.txt
@@ -306,12 +352,57 @@ void Args::parse(const string& line) {
     } else if (key == "-od") {
       double od = stod(s);
       fftOverdrive = 1 + od / 1000;
+    } else if (key == "-bpw") {
+      bpwFile = s;
+    } else if (key == "-metrics") {
+      metricsFile = s;
+    } else if (key == "-jsonlog") {
+      jsonLogFile = s;
+    } else if (key == "-control") {
+      controlSocket = s;
+    } else if (key == "-fixedCheck") {
+      adaptiveCheck = false;
+    } else if (key == "-roeSpike") {
+      roeSpike = stod(s);
+    } else if (key == "-sumCheck") {
+      sumCheck = true;
+    } else if (key == "-injectError") {
+      injectErrorK = stoul(s);
+    } else if (key == "-probe") {
+      probeMinZ = s.empty() ? 28 : stod(s);
+    } else if (key == "-migrate") {
+      migrateLowZ = 24;
+      migrateHighZ = 40;
+      if (!s.empty()) {
+        auto pos = s.find(',');
+        if (pos == string::npos) { throw "-migrate expects <low>,<high>"; }
+        migrateLowZ = stod(s.substr(0, pos));
+        migrateHighZ = stod(s.substr(pos + 1));
+      }
     } else if (key == "-roe") {
       assert(s.empty());
       logROE = true;
     } else if (key == "-tune") {
-      assert(s.empty());
       doTune = true;
+      for (const string& mode : split(s, ',')) {
+        if (mode == "full") {
+          tuneMode = TUNE_FULL;
+        } else if (mode == "compare") {
+          tuneMode = TUNE_COMPARE;
+        } else if (mode == "work") {
+          tuneForWork = true;
+        } else if (mode == "nomodel") {
+          tuneCostModel = false;
+        } else if (!mode.empty()) {
+          log("-tune expects a list of 'full', 'compare', 'work', 'nomodel', not '%s'\n", s.c_str());
+          throw "-tune";
+        }
+      }
+    } else if (key == "-tuneBudget") {
+      tuneBudget = stod(s);
+    } else if (key == "-tuneFresh") {
+      assert(s.empty());
+      tuneFresh = true;
     } else if (key == "-ctune") {
       doCtune = true;
       if (!s.empty()) { ctune.push_back(s); }
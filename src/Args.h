@@ -22,6 +22,7 @@ public:
   static std::string mergeArgs(int argc, char **argv);
 
   enum {CARRY_AUTO = 0, CARRY_SHORT, CARRY_LONG};
+  enum {TUNE_RACE = 0, TUNE_FULL, TUNE_COMPARE};
 
   explicit Args(bool silent = false) : silent{silent} {}
   
@@ -71,6 +72,11 @@ public:
   bool keepProof = false;
 
   int carry = CARRY_AUTO;
+  int tuneMode = TUNE_RACE;
+  double tuneBudget = 0; // seconds; 0 means no limit
+  bool tuneForWork{};
+  bool tuneCostModel = true;
+  bool tuneFresh{};
   u32 workers = 1;
   u32 blockSize = 1000;
   u32 logStep = 20000;
@@ -88,6 +94,39 @@ public:
   // The FFT will handle up to fft.maxExp() * fftOverdrive
   // May also take values <1 to lower the max E handled.
   double fftOverdrive = 1;
+
+  // When non-zero, probe the ROE of the cheapest FFTs near the exponent at task start, and use the fastest
+  // that reaches this Z.
+  double probeMinZ = 0;
+
+  // Adapt the PRP check step to the error history of the device.
+  bool adaptiveCheck = true;
+
+  // A sampled ROE above this triggers a Gerbicz check right away; 0 disables.
+  double roeSpike = 0.45;
+
+  // The SUMINP/SUMOUT check in carryFused; a mismatch triggers a Gerbicz check right away.
+  bool sumCheck = false;
+
+  // For testing: corrupt the PRP data (with a ROE spike) once, at this iteration.
+  u32 injectErrorK = 0;
+
+  // A file with BPW limits in the fftbpw.h format, overriding the built-in ones.
+  fs::path bpwFile;
+
+  // The Prometheus textfile with the per-worker metrics; empty for none.
+  fs::path metricsFile;
+
+  // The JSON-lines event log; empty for none.
+  fs::path jsonLogFile;
+
+  // The Unix-domain socket of the runtime control (status, save, stop, pause, reload); empty for none.
+  fs::path controlSocket;
+
+  // When migrateLowZ is non-zero, a PRP test switches to a larger FFT at a verified checkpoint when the Z of the
+  // sampled ROE falls below migrateLowZ, and back to a smaller one when Z goes above migrateHighZ.
+  double migrateLowZ = 0;
+  double migrateHighZ = 0;
   
   void printHelp();
 };
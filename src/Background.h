@@ -3,6 +3,7 @@
 #pragma once
 
 #include "log.h"
+#include "HostOp.h"
 #include "typeName.h"
 
 #include <string>
@@ -70,13 +71,16 @@ public:
 
   void waitEmpty() {
     std::unique_lock lock(mut);
+    if (tasks.empty()) { return; }
+    HostOp op{"backgroundWait"};
     while (!tasks.empty()) { cond.wait(lock); }
   }
 
   template<typename T> void operator()(T task) {
     std::unique_lock lock(mut);
-    while (tasks.size() >= maxSize) {
-      cond.wait(lock);
+    if (tasks.size() >= maxSize) {
+      HostOp op{"backgroundWait"};
+      while (tasks.size() >= maxSize) { cond.wait(lock); }
     }
     tasks.push_back(task);
     cond.notify_all();
@@ -6,31 +6,35 @@
 #include "AllocTrac.h"
 #include "Context.h"
 #include "Queue.h"
+#include "TimeInfo.h"
 
 #include <memory>
 #include <vector>
 #include <cassert>
 
-class TimeInfo;
-
 template<typename T>
 class Buffer {
 private:
+  // Before ptr: the maxAlloc check comes before taking the memory from the pool.
+  AllocTrac allocTrac;
   std::unique_ptr<cl_mem> ptr;
 
 public:
   const size_t size{};
 
 private:
-  AllocTrac allocTrac;
-
+  BufferPool* pool;
+  unsigned flags;
   Queue* queue;
   TimeInfo *tInfo;
   
-  Buffer(cl_context context, TimeInfo *tInfo, Queue* queue, size_t size, unsigned flags, const T* ptr = nullptr)
-    : ptr{size == 0 ? NULL : makeBuf_(context, flags, size * sizeof(T), ptr)}
+  Buffer(const Context* context, string_view name, TimeInfo *tInfo, Queue* queue, size_t size, unsigned flags,
+         const T* ptr = nullptr)
+    : allocTrac(size * sizeof(T), AllocTrac::categoryOf(name))
+    , ptr{size == 0 ? NULL : context->pool()->acquire(flags, size * sizeof(T), ptr)}
     , size{size}
-    , allocTrac(size * sizeof(T))
+    , pool{context->pool()}
+    , flags{flags}
     , queue{queue}
     , tInfo{tInfo}
   {}
@@ -41,24 +45,30 @@ private:
   }
 
 public:
-  Buffer(const Context* context, std::vector<T>&& vect)
-    : Buffer(context->get(), nullptr /* no time info */, nullptr /* no queue */, vect.size(),
+  // The name determines the AllocTrac category.
+  Buffer(const Context* context, string_view name, std::vector<T>&& vect)
+    : Buffer(context, name, nullptr /* no time info */, nullptr /* no queue */, vect.size(),
              CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_NO_ACCESS, vect.data())
   {}
 
   Buffer(TimeInfo *tInfo, Queue* queue, size_t size)
-    : Buffer(queue->context->get(), tInfo, queue, size, CL_MEM_READ_WRITE /*| CL_MEM_HOST_NO_ACCESS*/) {}
+    : Buffer(queue->context, tInfo->name, tInfo, queue, size, CL_MEM_READ_WRITE /*| CL_MEM_HOST_NO_ACCESS*/) {}
 
   Buffer(Buffer&& rhs) = default;
 
+  // The device memory goes back to the context's pool for reuse rather than being released.
+  ~Buffer() { if (ptr) { pool->release(ptr.release(), flags, size * sizeof(T)); } }
+
   Buffer& operator=(Buffer&& rhs) {
-    assert(size == rhs.size);
+    assert(size == rhs.size && flags == rhs.flags && pool == rhs.pool);
     std::swap(ptr, rhs.ptr);
     return *this;
   }
 
   cl_mem get() const { return ptr.get(); }
 
+  void addTo(AllocTrac::Footprint& f) const { allocTrac.addTo(f); }
+
   void read(T* out, size_t readSize) const {
     assert(readSize && readSize <= size);
     queue->readSync(get(), readSize * sizeof(T), out, tInfo);
@@ -84,6 +94,11 @@ public:
 
   void write(const vector<T>& vect) { queue->write(get(), vect, tInfo); }
 
+  void write(const T* data, size_t writeSize) {
+    assert(writeSize && writeSize <= size);
+    queue->write(get(), data, writeSize, tInfo);
+  }
+
   void zero(size_t len = 0) {
     fill(0, len);
   }
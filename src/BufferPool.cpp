@@ -0,0 +1,85 @@
+// Copyright (C) Mihai Preda
+
+#include "BufferPool.h"
+#include "AllocTrac.h"
+#include "log.h"
+
+#include <algorithm>
+#include <new>
+#include <cassert>
+
+BufferPool::~BufferPool() { purge(); }
+
+// Must be called with the mutex held, or from the destructor.
+void BufferPool::purge() {
+  for (auto& [key, bufs] : idle) {
+    for (cl_mem buf : bufs) { ::release(buf); }
+  }
+  idle.clear();
+  idleBytes = 0;
+}
+
+// Must be called with the mutex held.
+void BufferPool::logPurge() {
+  if (idleBytes) {
+    log("Buffer pool: releasing %.1f MB of idle buffers\n", idleBytes / (1024.0 * 1024));
+    purge();
+  }
+}
+
+void BufferPool::trim() {
+  std::lock_guard lock(mut);
+  logPurge();
+}
+
+cl_mem BufferPool::acquire(unsigned flags, size_t size, const void* ptr) {
+  if (!isPoolable(flags)) { return makeBuf_(context, flags, size, ptr); }
+
+  std::lock_guard lock(mut);
+  if (auto it = idle.find({size, flags}); it != idle.end() && !it->second.empty()) {
+    cl_mem buf = it->second.back();
+    it->second.pop_back();
+    idleBytes -= size;
+    usedBytes += size;
+    ++nReuse;
+    return buf;
+  }
+
+  // The new buffer is already counted by AllocTrac; with the idle ones it must fit in maxAlloc.
+  if (AllocTrac::totalAllocBytes() + idleBytes > AllocTrac::maxAllocBytes()) { logPurge(); }
+
+  cl_mem buf{};
+  try {
+    buf = makeBuf_(context, flags, size, ptr);
+  } catch (const std::bad_alloc&) {
+    if (!idleBytes) { throw; }
+    // The idle buffers may be what's taking up the memory; give them back and try again.
+    logPurge();
+    buf = makeBuf_(context, flags, size, ptr);
+  }
+  usedBytes += size;
+  peakBytes = std::max(peakBytes, usedBytes + idleBytes);
+  ++nAlloc;
+  return buf;
+}
+
+void BufferPool::release(cl_mem buf, unsigned flags, size_t size) {
+  if (!isPoolable(flags)) {
+    ::release(buf);
+    return;
+  }
+
+  std::lock_guard lock(mut);
+  assert(usedBytes >= size);
+  usedBytes -= size;
+  idleBytes += size;
+  idle[{size, flags}].push_back(buf);
+}
+
+std::string BufferPool::stats() {
+  std::lock_guard lock(mut);
+  char buf[256];
+  snprintf(buf, sizeof(buf), "Buffer pool: %u reused, %u allocated; in use %.1f MB, idle %.1f MB, peak %.1f MB",
+           nReuse, nAlloc, usedBytes / (1024.0 * 1024), idleBytes / (1024.0 * 1024), peakBytes / (1024.0 * 1024));
+  return buf;
+}
@@ -0,0 +1,49 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "clwrap.h"
+#include "common.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* A per-context pool of device buffers, keyed by (size, flags).
+   A released buffer is kept for reuse by the next allocation of the same size and kind, instead of going through
+   clReleaseMemObject() / clCreateBuffer(). This way a worker that moves between exponents on the same FFT (thus
+   re-creating the Gpu with an identical set of buffers) does not allocate anything on the device.
+   Buffers initialized from host memory (CL_MEM_COPY_HOST_PTR) are not pooled.
+   The idle buffers count against -maxAlloc together with the ones in use (see AllocTrac), and the ones not taken
+   by a new Gpu are released by trim(), so buffers of an FFT size no longer used do not accumulate.
+*/
+class BufferPool {
+  cl_context context;
+  std::mutex mut;
+  std::map<std::pair<size_t, unsigned>, std::vector<cl_mem>> idle;
+
+  size_t idleBytes{};
+  size_t usedBytes{};
+  size_t peakBytes{};
+  u32 nAlloc{};
+  u32 nReuse{};
+
+  void purge();
+  void logPurge();
+
+public:
+  explicit BufferPool(cl_context context) : context{context} {}
+  ~BufferPool();
+
+  static bool isPoolable(unsigned flags) { return !(flags & CL_MEM_COPY_HOST_PTR); }
+
+  cl_mem acquire(unsigned flags, size_t size, const void* ptr = nullptr);
+  void release(cl_mem buf, unsigned flags, size_t size);
+
+  // Releases the idle buffers.
+  void trim();
+
+  std::string stats();
+};
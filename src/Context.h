@@ -3,13 +3,22 @@
 #pragma once
 
 #include "clwrap.h"
+#include "BufferPool.h"
 
 #include <memory>
 
 class Context : public std::unique_ptr<cl_context> {
   cl_device_id id;
+  std::unique_ptr<BufferPool> bufPool;
+
 public:
-  explicit Context(cl_device_id id): unique_ptr<cl_context>{createContext(id)}, id{id} {}
+  explicit Context(cl_device_id id):
+    unique_ptr<cl_context>{createContext(id)},
+    id{id},
+    bufPool{make_unique<BufferPool>(get())}
+  {}
   
   cl_device_id deviceId() const { return id; }
+
+  BufferPool* pool() const { return bufPool.get(); }
 };
@@ -0,0 +1,263 @@
+// Copyright (C) Mihai Preda
+
+#include "Control.h"
+#include "Metrics.h"
+#include "Signal.h"
+#include "HostOp.h"
+#include "log.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifndef __MINGW32__
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<u32> requests[Control::MAX_WORKERS];
+std::atomic<bool> isEnabled{};
+u32 nWorkers = 0;
+
+std::mutex pauseMutex;
+std::condition_variable pauseCond;
+
+thread_local u32 worker = 0;
+
+const char* requestNames[] = {"save", "stop", "reload", "pause"};
+
+string pendingString(u32 r) {
+  string s;
+  for (u32 i = 0; i < 4; ++i) {
+    if (r & (1u << i)) { s += " "s + requestNames[i]; }
+  }
+  return s;
+}
+
+string status() {
+  auto workers = Metrics::snapshot();
+  string out;
+  char buf[256];
+  for (u32 w = 0; w < nWorkers; ++w) {
+    u32 r = requests[w].load(std::memory_order_relaxed);
+    auto it = workers.find(w);
+    if (it == workers.end()) {
+      snprintf(buf, sizeof(buf), "worker %u: starting", w);
+    } else {
+      const WorkerMetrics& m = it->second;
+      snprintf(buf, sizeof(buf), "worker %u: %s %u %u/%u (%.2f%%) %.0f us/it ETA %.1fh checks %u OK %u EE Z=%.1f",
+               w, m.kind.c_str(), m.exponent, m.k, m.kEnd, m.kEnd ? 100.0 * m.k / m.kEnd : 0.0, m.usPerIt,
+               m.etaSecs / 3600, m.checksOK, m.checksFailed, m.roeZ);
+    }
+    out += buf;
+    if (r & Control::PAUSE) { out += " [paused]"; }
+    if (r & ~Control::PAUSE) { out += " [pending:" + pendingString(r & ~Control::PAUSE) + "]"; }
+    out += '\n';
+  }
+  return out;
+}
+
+// Applies one command line; returns the reply.
+string execute(const string& line) {
+  std::istringstream in{line};
+  string cmd, target;
+  in >> cmd >> target;
+
+  if (cmd == "status") { return status(); }
+
+  u32 from = 0, to = nWorkers;
+  if (!target.empty() && target != "all") {
+    char* end{};
+    unsigned long w = strtoul(target.c_str(), &end, 10);
+    if (*end || w >= nWorkers) { return "error: no worker '" + target + "'\n"; }
+    from = w;
+    to = w + 1;
+  }
+
+  u32 set = 0, clear = 0;
+  if (cmd == "save") {
+    set = Control::SAVE;
+  } else if (cmd == "stop") {
+    set = Control::STOP;
+  } else if (cmd == "reload") {
+    set = Control::RELOAD;
+  } else if (cmd == "pause") {
+    set = Control::PAUSE;
+  } else if (cmd == "resume") {
+    clear = Control::PAUSE;
+  } else {
+    return "error: unknown command '" + cmd + "'; expected status, save, stop, pause, resume or reload\n";
+  }
+
+  {
+    std::lock_guard lock{pauseMutex};
+    for (u32 w = from; w < to; ++w) {
+      requests[w].fetch_or(set, std::memory_order_relaxed);
+      requests[w].fetch_and(~clear, std::memory_order_relaxed);
+    }
+  }
+  pauseCond.notify_all();
+  log("control: %s\n", line.c_str());
+  return "ok\n";
+}
+
+#ifndef __MINGW32__
+
+class Listener {
+public:
+  Listener(const fs::path& path) : path{path} {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) { throw "control: socket() failed: "s + strerror(errno); }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    string name = path.string();
+    if (name.size() >= sizeof(addr.sun_path)) { throw "control: socket path too long: "s + name; }
+    strcpy(addr.sun_path, name.c_str());
+
+    // A socket left over by a previous run would make bind() fail; but if something answers on it, it is the socket
+    // of a running instance.
+    if (fs::is_socket(path)) {
+      int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+      bool isLive = probe >= 0 && connect(probe, (sockaddr*) &addr, sizeof(addr)) == 0;
+      if (probe >= 0) { close(probe); }
+      if (isLive) {
+        close(fd);
+        throw "control: '"s + name + "' is in use by another instance";
+      }
+      fs::remove(path);
+    }
+
+    bool isBound = false;
+    auto fail = [&](const string& err) {
+      close(fd);
+      std::error_code dummy;
+      if (isBound) { fs::remove(path, dummy); }
+      throw "control: can't listen on '"s + name + "': " + err;
+    };
+
+    if (bind(fd, (sockaddr*) &addr, sizeof(addr))) { fail(strerror(errno)); }
+    isBound = true;
+
+    // Owner-only, whatever the umask: the socket takes commands. Nobody can connect before listen().
+    std::error_code ec;
+    fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write, ec);
+    if (ec) { fail(ec.message()); }
+
+    if (listen(fd, 4)) { fail(strerror(errno)); }
+
+    thread = std::jthread{[this](std::stop_token stop) { run(stop); }};
+  }
+
+  ~Listener() {
+    thread.request_stop();
+    thread.join();
+    close(fd);
+    std::error_code dummy;
+    fs::remove(path, dummy);
+  }
+
+private:
+  fs::path path;
+  int fd = -1;
+  std::jthread thread;
+
+  // Waits up to timeoutMs for fd to be readable.
+  static bool readable(int fd, int timeoutMs) {
+    pollfd p{fd, POLLIN, 0};
+    return poll(&p, 1, timeoutMs) > 0;
+  }
+
+  void run(std::stop_token stop) {
+    while (!stop.stop_requested()) {
+      if (!readable(fd, 500)) { continue; }
+      int client = accept(fd, nullptr, nullptr);
+      if (client < 0) { continue; }
+      serve(client);
+      close(client);
+    }
+  }
+
+  // Reads the commands of one client until it closes or is idle for a second.
+  void serve(int client) {
+    string pending;
+    char buf[512];
+    while (pending.size() < 4096 && readable(client, 1000)) {
+      ssize_t n = read(client, buf, sizeof(buf));
+      if (n <= 0) { break; }
+      pending.append(buf, n);
+      size_t pos;
+      while ((pos = pending.find('\n')) != string::npos) {
+        string line = pending.substr(0, pos);
+        pending.erase(0, pos + 1);
+        if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+        if (line.empty()) { continue; }
+        string reply = execute(line);
+        if (write(client, reply.data(), reply.size()) < 0) { return; }
+      }
+    }
+    if (!pending.empty()) {
+      // The last command, without a newline.
+      string reply = execute(pending);
+      [[maybe_unused]] auto n = write(client, reply.data(), reply.size());
+    }
+  }
+};
+
+#else
+
+class Listener {
+public:
+  Listener(const fs::path&) { throw "-control is not supported on Windows"; }
+};
+
+#endif
+
+std::unique_ptr<Listener> listener;
+
+} // namespace
+
+void Control::start(const fs::path& socketPath, u32 workers) {
+  assert(workers <= MAX_WORKERS);
+  nWorkers = workers;
+  listener = std::make_unique<Listener>(socketPath);
+  isEnabled = true;
+}
+
+void Control::shutdown() {
+  isEnabled = false;
+  listener.reset();
+}
+
+bool Control::enabled() { return isEnabled; }
+
+void Control::setWorker(u32 instance) { worker = instance; }
+
+u32 Control::pending() { return requests[worker].load(std::memory_order_relaxed); }
+
+void Control::done(Request r) { requests[worker].fetch_and(~u32(r), std::memory_order_relaxed); }
+
+void Control::waitWhilePaused() {
+  auto paused = [] {
+    u32 r = requests[worker].load(std::memory_order_relaxed);
+    return (r & PAUSE) && !(r & (STOP | RELOAD)) && !Signal::stopRequested();
+  };
+
+  if (!paused()) { return; }
+  HostOp op{"pause"};
+  log("Paused\n");
+  std::unique_lock lock{pauseMutex};
+  // Ctrl-C can't notify, so look again every second.
+  while (paused()) { pauseCond.wait_for(lock, std::chrono::seconds(1)); }
+  log("Resumed\n");
+}
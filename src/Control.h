@@ -0,0 +1,50 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "common.h"
+
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Thrown at a safe point of a test after a "reload" request; the worker then picks its next task from worktodo.
+struct ReloadRequest {};
+
+/* Opt-in (-control <socket>) runtime control through a local Unix-domain socket. A client sends one command per line:
+     status                 : one line per worker: the test, iteration, us/it, ETA, checks, ROE Z, pending requests
+     save    [<worker>]     : do a checkpoint (PRP: a Gerbicz check then a savefile) at the next safe point
+     stop    [<worker>]     : stop after the next checkpoint, as on Ctrl-C
+     pause   [<worker>]     : wait at the next log point until resumed (the GPU goes idle)
+     resume  [<worker>]
+     reload  [<worker>]     : stop the current test after a checkpoint and pick again the best task from worktodo
+   Without <worker> a command applies to all the workers. E.g. "echo status | socat - UNIX-CONNECT:prpll.sock".
+
+   The requests are only flags: the workers read them at the points where they already check for Ctrl-C, without
+   any synchronisation with the listener thread or the GPU.
+*/
+class Control {
+public:
+  enum Request : u32 {SAVE = 1, STOP = 2, RELOAD = 4, PAUSE = 8};
+
+  static constexpr u32 MAX_WORKERS = 4; // as -workers
+
+  static void start(const fs::path& socketPath, u32 nWorkers);
+
+  // Stops listening and removes the socket.
+  static void shutdown();
+
+  static bool enabled();
+
+  // The worker of the calling thread.
+  static void setWorker(u32 instance);
+
+  // The pending requests of the calling thread's worker (a relaxed load, cheap enough for every iteration).
+  static u32 pending();
+
+  // Clears the request once it was honored.
+  static void done(Request r);
+
+  // Blocks while the calling thread's worker is paused, until resumed or asked to stop.
+  static void waitWhilePaused();
+};
@@ -0,0 +1,122 @@
+// Copyright (C) Mihai Preda
+
+#include "CostModel.h"
+
+#include <cmath>
+#include <cassert>
+
+namespace {
+
+// Full passes over the data per squaring: fftMidIn, tailSquare, fftMidOut, carryFused.
+constexpr double PASSES = 4;
+
+// Solve A * x = b in place by Gaussian elimination with partial pivoting.
+template<size_t K>
+std::array<double, K> solve(std::array<std::array<double, K>, K> A, std::array<double, K> b) {
+  for (size_t col = 0; col < K; ++col) {
+    size_t pivot = col;
+    for (size_t r = col + 1; r < K; ++r) { if (fabs(A[r][col]) > fabs(A[pivot][col])) { pivot = r; } }
+    std::swap(A[col], A[pivot]);
+    std::swap(b[col], b[pivot]);
+    for (size_t r = col + 1; r < K; ++r) {
+      double f = A[r][col] / A[col][col];
+      for (size_t c = col; c < K; ++c) { A[r][c] -= f * A[col][c]; }
+      b[r] -= f * b[col];
+    }
+  }
+  std::array<double, K> x{};
+  for (size_t col = K; col-- > 0;) {
+    double s = b[col];
+    for (size_t c = col + 1; c < K; ++c) { s -= A[col][c] * x[c]; }
+    x[col] = s / A[col][col];
+  }
+  return x;
+}
+
+} // namespace
+
+std::array<double, CostModel::N_FEATURES> CostModel::features(FFTConfig fft) {
+  double N = fft.size();
+  u32 v = fft.variant;
+  return {
+    1,                                          // kernel launches
+    PASSES * 2 * sizeof(double) * N,            // bytes read and written
+    2 * 5 * N * log2(N),                        // FLOPs of the forward and inverse FFT
+    N * fft.shape.middle,                       // the middle step is not a radix-2 FFT
+    N * (variant_W(v) + variant_M(v) + variant_H(v)), // more accurate trig costs more DP
+    N * (fft.carry == CARRY_64),
+  };
+}
+
+void CostModel::fit(const vector<Sample>& samples) {
+  constexpr u32 K = N_FEATURES;
+  fitted = false;
+  if (samples.size() < 2) { return; }
+
+  // Normalize the columns, as their magnitudes are very different.
+  std::array<double, K> scale{};
+  for (const auto& [fft, t] : samples) {
+    auto x = features(fft);
+    for (u32 i = 0; i < K; ++i) { scale[i] = std::max(scale[i], fabs(x[i])); }
+  }
+  for (double& s : scale) { if (s == 0) { s = 1; } }
+
+  // Normal equations with a little ridge, so that features that don't vary among the samples stay small.
+  std::array<std::array<double, K>, K> A{};
+  std::array<double, K> b{};
+  for (const auto& [fft, t] : samples) {
+    auto x = features(fft);
+    for (u32 i = 0; i < K; ++i) { x[i] /= scale[i]; }
+    for (u32 i = 0; i < K; ++i) {
+      for (u32 j = 0; j < K; ++j) { A[i][j] += x[i] * x[j] / (t * t); }
+      b[i] += x[i] / t;
+    }
+  }
+  for (u32 i = 0; i < K; ++i) { A[i][i] += 1e-6 * samples.size(); }
+
+  auto x = solve(A, b);
+  for (u32 i = 0; i < K; ++i) { theta[i] = x[i] / scale[i]; }
+  fitted = true;
+}
+
+double CostModel::predict(FFTConfig fft) const {
+  assert(fitted);
+  auto x = features(fft);
+  double t = 0;
+  for (u32 i = 0; i < N_FEATURES; ++i) { t += theta[i] * x[i]; }
+  return t;
+}
+
+double CostModel::rmsError(const vector<Sample>& samples) const {
+  if (samples.empty()) { return 0; }
+  double sum = 0;
+  for (const auto& [fft, t] : samples) {
+    double e = predict(fft) / t - 1;
+    sum += e * e;
+  }
+  return sqrt(sum / samples.size());
+}
+
+double CostModel::looError(const vector<Sample>& samples) {
+  if (samples.size() < 3) { return INFINITY; }
+  double sum = 0;
+  for (u32 k = 0; k < samples.size(); ++k) {
+    vector<Sample> others = samples;
+    others.erase(others.begin() + k);
+    CostModel m;
+    m.fit(others);
+    auto [fft, t] = samples[k];
+    double e = m.predict(fft) / t - 1;
+    sum += e * e;
+  }
+  return sqrt(sum / samples.size());
+}
+
+std::string CostModel::describe() const {
+  char buf[128];
+  // theta is in us per byte (resp. per FLOP)
+  double GBs = theta[1] > 0 ? 1e-3 / theta[1] : 0;
+  double GFLOPS = theta[2] > 0 ? 1e-3 / theta[2] : 0;
+  snprintf(buf, sizeof(buf), "launch %.1f us, bandwidth %.0f GB/s, %.0f GFLOPS", theta[0], GBs, GFLOPS);
+  return buf;
+}
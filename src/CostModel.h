@@ -0,0 +1,43 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "FFTConfig.h"
+#include "common.h"
+
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* A linear model of the time per PRP iteration of an FFT config:
+     t = launch + bytes / bandwidth + flops / flopRate + (shape and variant terms)
+   The coefficients are fitted (least squares) to a few timed configs; the fit gives the effective memory bandwidth
+   and FLOP rate of the device. Tune uses it to rank the candidates and prune the ones that are predicted to be
+   clearly slower than a candidate that handles at least the same exponent.
+*/
+class CostModel {
+public:
+  static constexpr u32 N_FEATURES = 6;
+  using Sample = std::pair<FFTConfig, double>; // config, measured us/it
+
+  static std::array<double, N_FEATURES> features(FFTConfig fft);
+
+  void fit(const std::vector<Sample>& samples);
+  bool isFitted() const { return fitted; }
+
+  double predict(FFTConfig fft) const;
+
+  // Root-mean-square of the relative prediction error over the samples.
+  double rmsError(const std::vector<Sample>& samples) const;
+
+  // The same, with each sample predicted by a model fitted to the other samples (leave-one-out): with few samples
+  // per coefficient the error of the fit on its own samples is optimistic.
+  static double looError(const std::vector<Sample>& samples);
+
+  std::string describe() const;
+
+private:
+  std::array<double, N_FEATURES> theta{};
+  bool fitted{};
+};
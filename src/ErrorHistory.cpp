@@ -0,0 +1,74 @@
+// Copyright (C) Mihai Preda
+
+#include "ErrorHistory.h"
+#include "File.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+// The workers share the file.
+std::mutex historyMutex;
+
+std::map<std::string, std::pair<double, double>> readHistory(const fs::path& path) {
+  std::map<std::string, std::pair<double, double>> ret;
+  File fi = File::openRead(path);
+  if (!fi) { return ret; }
+
+  for (const string& line : fi) {
+    std::istringstream in{line};
+    string device;
+    double iters{};
+    double errors{};
+    if (in >> device >> iters >> errors) {
+      ret[device] = {iters, errors};
+    } else {
+      log("%s: ignored line '%s'\n", path.string().c_str(), rstripNewline(line).c_str());
+    }
+  }
+  return ret;
+}
+
+// The device name as a single word of the file.
+std::string deviceKey(std::string device) {
+  std::replace(device.begin(), device.end(), ' ', '_');
+  return device.empty() ? std::string{"-"} : device;
+}
+
+} // namespace
+
+ErrorHistory::ErrorHistory(fs::path path, std::string device) : path{path}, device{deviceKey(std::move(device))} {}
+
+std::pair<double, double> ErrorHistory::get() const {
+  std::lock_guard lock{historyMutex};
+  auto history = readHistory(path);
+  auto it = history.find(device);
+  return it == history.end() ? std::pair<double, double>{} : it->second;
+}
+
+void ErrorHistory::add(u64 iters, u32 errors) {
+  std::lock_guard lock{historyMutex};
+  auto history = readHistory(path);
+  auto& [totalIters, totalErrors] = history[device];
+  double decay = exp2(-(iters / HALF_LIFE));
+  totalIters = totalIters * decay + iters;
+  totalErrors = totalErrors * decay + errors;
+
+  fs::path tmp = path;
+  tmp += ".new";
+  {
+    File fo = File::openWrite(tmp);
+    for (const auto& [d, v] : history) { fo.printf("%s %.0f %.4f\n", d.c_str(), v.first, v.second); }
+  }
+  fs::rename(tmp, path);
+}
+
+double ErrorHistory::rate() const {
+  auto [iters, errors] = get();
+  return (errors + PRIOR_ERRORS) / (iters + PRIOR_ITERS);
+}
@@ -0,0 +1,38 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "common.h"
+
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+/* Per-device counts of the PRP iterations done and of the Gerbicz errors found, kept across runs in a file with
+   one line per device:
+     <device> <iterations> <errors>
+   Used to adapt the PRP check step to how often the GPU actually makes errors. The counts decay with a half-life of
+   HALF_LIFE iterations, so that a device that starts failing is not masked by a long clean history.
+*/
+class ErrorHistory {
+  fs::path path;
+  std::string device;
+
+public:
+  // A fresh device is assumed to have had PRIOR_ERRORS errors in PRIOR_ITERS iterations.
+  static constexpr double PRIOR_ITERS = 1e9;
+  static constexpr double PRIOR_ERRORS = 2;
+
+  static constexpr double HALF_LIFE = 1e9;
+
+  ErrorHistory(fs::path path, std::string device);
+
+  // The decayed iterations and errors recorded for the device.
+  std::pair<double, double> get() const;
+
+  void add(u64 iters, u32 errors);
+
+  // The estimated errors per iteration, including the prior.
+  double rate() const;
+};
@@ -5,9 +5,10 @@
 
 #include <cassert>
 
-Event::Event(EventHolder&& e, TimeInfo* tInfo) :
+Event::Event(EventHolder&& e, TimeInfo* tInfo, const char* hostOp) :
   event{std::move(e)},
-  tInfo{tInfo}
+  tInfo{tInfo},
+  hostOp{hostOp}
 {
   assert(tInfo);
 }
@@ -19,7 +20,8 @@ Event::~Event() {
 
 bool Event::isComplete() {
   if (event && getEventInfo(event.get()) == CL_COMPLETE) {
-      tInfo->add(getEventNanos(get()));
+      timestamps = getEventTimestamps(get());
+      tInfo->add(getEventNanos(timestamps));
       event.reset();
   }
   return !event;
@@ -4,6 +4,8 @@
 
 #include "clwrap.h"
 
+#include <array>
+
 class TimeInfo;
 
 class Event {
@@ -12,8 +14,10 @@ class Event {
 public:
   EventHolder event;
   TimeInfo *tInfo;
+  const char* hostOp; // see HostOp::take()
+  std::array<u64, 4> timestamps{}; // set on completion, see getEventTimestamps()
 
-  Event(EventHolder&& e, TimeInfo *tInfo);
+  Event(EventHolder&& e, TimeInfo *tInfo, const char* hostOp);
   Event(Event&& oth) = default;
   ~Event();
 
@@ -5,6 +5,7 @@
 #include "common.h"
 #include "log.h"
 #include "TuneEntry.h"
+#include "File.h"
 
 #include <cmath>
 #include <cassert>
@@ -38,6 +39,36 @@ u32 parseInt(const string& s) {
 
 } // namespace
 
+// Each entry is a line like the ones in fftbpw.h:
+// { "256:13:256", {18.423, 18.693, 18.794, 18.497, 18.820, 18.938}},
+u32 FFTShape::loadBpw(const fs::path& path) {
+  File fi = File::openReadThrow(path);
+  u32 n = 0;
+  for (string line : fi) {
+    auto q1 = line.find('"');
+    if (line.find("//") < q1 || q1 == string::npos) { continue; } // blank or comment
+    auto q2 = line.find('"', q1 + 1);
+    auto open = line.find('{', q2);
+    auto close = line.find('}', open);
+    if (q2 == string::npos || open == string::npos || close == string::npos) {
+      log("%s: can't parse '%s'\n", path.string().c_str(), rstripNewline(line).c_str());
+      throw "BPW file";
+    }
+
+    string spec = line.substr(q1 + 1, q2 - q1 - 1);
+    auto values = split(line.substr(open + 1, close - open - 1), ',');
+    if (values.size() != NUM_BPW_ENTRIES) {
+      log("%s: expected %u values for %s\n", path.string().c_str(), NUM_BPW_ENTRIES, spec.c_str());
+      throw "BPW file";
+    }
+    array<double, NUM_BPW_ENTRIES> bpw;
+    for (u32 i = 0; i < NUM_BPW_ENTRIES; ++i) { bpw[i] = stod(values[i]); }
+    BPW[spec] = bpw;
+    ++n;
+  }
+  return n;
+}
+
 // Accepts:
 // - a single config: 1K:13:256
 // - a size: 6.5M
@@ -262,6 +293,24 @@ FFTConfig FFTConfig::bestFit(const Args& args, u32 E, const string& spec) {
   throw "No FFT";
 }
 
+std::optional<FFTConfig> FFTConfig::neighbour(const Args& args, u32 E, const FFTConfig& fft, bool larger) {
+  std::optional<FFTConfig> ret;
+  for (const TuneEntry& e : TuneEntry::readTuneFile(args)) {
+    if (larger && e.fft.maxExp() > fft.maxExp()) { return e.fft; }
+    if (!larger && e.fft.maxExp() < fft.maxExp() && E <= e.fft.maxExp() * args.fftOverdrive) { ret = e.fft; }
+  }
+  return ret;
+}
+
+vector<FFTConfig> FFTConfig::nearFits(const Args& args, u32 E, double reach, u32 n) {
+  vector<FFTConfig> ret;
+  for (const TuneEntry& e : TuneEntry::readTuneFile(args)) {
+    if (ret.size() >= n) { break; }
+    if (E <= e.fft.maxExp() * args.fftOverdrive * reach) { ret.push_back(e.fft); }
+  }
+  return ret;
+}
+
 
 string numberK(u32 n) {
   u32 K = 1024;
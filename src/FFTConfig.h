@@ -7,8 +7,10 @@
 #include <string>
 #include <tuple>
 #include <vector>
+#include <optional>
 #include <array>
 #include <algorithm>
+#include <filesystem>
 
 // We pre-calculate the maximum BPW for a number of fft specs.  From these entries we can either look up or interpolate to get the
 // maximum BPW for all variants of an FFT spec.  The variants for which maximum bpw are precomputed are 000, 101, 202, 010, 111, 212.
@@ -31,6 +33,10 @@ public:
 
   static vector<FFTShape> multiSpec(const string& spec);
 
+  // Override the built-in BPW table (fftbpw.h) with the entries from a file in the same format, e.g. as written by
+  // -ztune to ztune.txt. Must be called before the shapes are constructed. Returns the number of entries loaded.
+  static u32 loadBpw(const std::filesystem::path& path);
+
   u32 width  = 0;
   u32 middle = 0;
   u32 height = 0;
@@ -72,6 +78,13 @@ struct FFTConfig {
 public:
   static FFTConfig bestFit(const Args& args, u32 E, const std::string& spec);
 
+  // The n cheapest tuned FFTs whose limit, extended by the factor reach, covers E; cheapest first.
+  static vector<FFTConfig> nearFits(const Args& args, u32 E, double reach, u32 n);
+
+  // The tuned FFT next to fft: the cheapest that reaches further, or the costliest with a lower reach that still
+  // handles E.
+  static std::optional<FFTConfig> neighbour(const Args& args, u32 E, const FFTConfig& fft, bool larger);
+
   FFTShape shape{};
   u32 variant;
   u32 carry;
@@ -27,7 +27,7 @@ File::File(const std::filesystem::__cxx11::path& path, const string& mode, bool
 File::~File() {
   if (!f) { return; }
 
-  if (!readOnly) { datasync(); }
+  if (!readOnly && !noSync) { datasync(); }
 
   fclose(f);
   f = nullptr;
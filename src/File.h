@@ -45,6 +45,7 @@ struct WriteError {
 class File {
   FILE* f = nullptr;
   const bool readOnly;
+  bool noSync{};
   
   File(const fs::path &path, const string& mode, bool throwOnError);
 
@@ -74,6 +75,13 @@ public:
   static File openReadThrow(const fs::path& name) { return File{name, "rb", true}; }
   
   static File openWrite(const fs::path& name) { return File{name, "wb", true}; }
+
+  // Without the fdatasync on close: for a file that is rewritten often and is worthless after a crash.
+  static File openWriteNoSync(const fs::path& name) {
+    File f{name, "wb", true};
+    f.noSync = true;
+    return f;
+  }
   
   static File openAppend(const fs::path &name) { return File{name, "ab", true}; }
   
@@ -83,7 +91,7 @@ public:
 
   File(FILE* f, const string& name) : f{f}, readOnly{false}, name{name} {}
   
-  File(File&& other) : f{other.f}, readOnly{other.readOnly}, name{other.name} { other.f = nullptr; }
+  File(File&& other) : f{other.f}, readOnly{other.readOnly}, noSync{other.noSync}, name{other.name} { other.f = nullptr; }
   
   File& operator=(File&& other);
 
@@ -16,6 +16,11 @@
 #include "TrigBufCache.h"
 #include "fs.h"
 #include "Sha3Hash.h"
+#include "Jacobi.h"
+#include "Metrics.h"
+#include "JsonLog.h"
+#include "Control.h"
+#include "HostOp.h"
 
 #include <algorithm>
 #include <bitset>
@@ -26,6 +31,7 @@
 
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <future>
 
 #ifndef M_PIl
 #define M_PIl 3.141592653589793238462643383279502884L
@@ -184,8 +190,22 @@ constexpr bool isInList(const string& s, initializer_list<string> list) {
   return false;
 }
 
-string clDefines(const Args& args, cl_device_id id, FFTConfig fft, const vector<KeyVal>& extraConf, u32 E, bool doLog,
-                 bool &tail_single_wide, bool &tail_single_kernel, u32 &tail_trigs, u32 &pad_size) {
+// The number of carryFused iterations between reads of the SUMINP/SUMOUT check (see sumMismatch()) that are checked.
+#define SUM_SIZE 20000
+// The SUMINP/SUMOUT tolerance, relative to the typical magnitude of the sums.
+const double SUM_TOLERANCE = 1e-9;
+
+// Only this close (in bits per word) to the CARRY32 limit is adaptive carry used.
+const double ADAPTIVE_CARRY_BPW = 0.3;
+
+// When the default is CARRY32 but close to its limit, both carry widths are compiled for carryFused and the carry
+// stats (STATS bit 0) are collected to choose between them at runtime.
+bool isAdaptiveCarry(const map<string, string>& config, FFTConfig fft, u32 E) {
+  return fft.carry == CARRY_AUTO && !fft.shape.needsLargeCarry(E) && !config.count("CARRY64")
+      && E / double(fft.shape.size()) > fft.shape.carry32BPW() - ADAPTIVE_CARRY_BPW;
+}
+
+map<string, string> mergedConfig(const Args& args, FFTConfig fft, const vector<KeyVal>& extraConf) {
   map<string, string> config;
 
   // Highest priority is the requested "extra" conf
@@ -199,12 +219,36 @@ string clDefines(const Args& args, cl_device_id id, FFTConfig fft, const vector<
     // log("Found %s\n", fft.shape.spec().c_str());
     config.insert(it->second.begin(), it->second.end());
   }
+  return config;
+}
 
+// Some -use options are needed in both OpenCL code and C++ initialization code
+void cppConfig(const map<string, string>& config, cl_device_id id,
+               bool &tail_single_wide, bool &tail_single_kernel, u32 &tail_trigs, u32 &pad_size) {
   // Default value for -use options that must also be parsed in C++ code
   tail_single_wide = 0, tail_single_kernel = 1;         // Default tailSquare is double-wide in one kernel
   tail_trigs = 2;                                       // Default is calculating from scratch, no memory accesses
   pad_size = isAmdGpu(id) ? 256 : 0;                    // Default is 256 bytes for AMD, 0 for others
 
+  for (const auto& [k, v] : config) {
+    if (k == "TAIL_KERNELS") {
+      if (atoi(v.c_str()) == 0) tail_single_wide = 1, tail_single_kernel = 1;
+      if (atoi(v.c_str()) == 1) tail_single_wide = 1, tail_single_kernel = 0;
+      if (atoi(v.c_str()) == 2) tail_single_wide = 0, tail_single_kernel = 1;
+      if (atoi(v.c_str()) == 3) tail_single_wide = 0, tail_single_kernel = 0;
+    }
+    if (k == "TAIL_TRIGS") tail_trigs = atoi(v.c_str());
+    if (k == "PAD") pad_size = atoi(v.c_str());
+  }
+}
+
+string clDefines(const Args& args, cl_device_id id, FFTConfig fft, const vector<KeyVal>& extraConf, u32 E, bool doLog,
+                 bool &tail_single_wide, bool &tail_single_kernel, u32 &tail_trigs, u32 &pad_size) {
+  map<string, string> config = mergedConfig(args, fft, extraConf);
+  cppConfig(config, id, tail_single_wide, tail_single_kernel, tail_trigs, pad_size);
+
+  if (isAdaptiveCarry(config, fft, E)) { config["STATS"] = to_string(atoi(config["STATS"].c_str()) | 1); }
+
   // Validate -use options
   for (const auto& [k, v] : config) {
     bool isValid = isInList(k, {
@@ -233,16 +277,6 @@ string clDefines(const Args& args, cl_device_id id, FFTConfig fft, const vector<
     if (!isValid) {
       log("Warning: unrecognized -use key '%s'\n", k.c_str());
     }
-
-    // Some -use options are needed in both OpenCL code and C++ initialization code
-    if (k == "TAIL_KERNELS") {
-      if (atoi(v.c_str()) == 0) tail_single_wide = 1, tail_single_kernel = 1;
-      if (atoi(v.c_str()) == 1) tail_single_wide = 1, tail_single_kernel = 0;
-      if (atoi(v.c_str()) == 2) tail_single_wide = 0, tail_single_kernel = 1;
-      if (atoi(v.c_str()) == 3) tail_single_wide = 0, tail_single_kernel = 0;
-    }
-    if (k == "TAIL_TRIGS") tail_trigs = atoi(v.c_str());
-    if (k == "PAD") pad_size = atoi(v.c_str());
   }
 
   string defines = toDefine(config);
@@ -260,6 +294,8 @@ string clDefines(const Args& args, cl_device_id id, FFTConfig fft, const vector<
 
   if (isAmdGpu(id)) { defines += toDefine("AMDGPU", 1); }
 
+  if (args.sumCheck) { defines += toDefine("SUMCHECK", SUM_SIZE); }
+
   if ((fft.carry == CARRY_AUTO && fft.shape.needsLargeCarry(E)) || (fft.carry == CARRY_64)) {
     if (doLog) { log("Using CARRY64\n"); }
     defines += toDefine("CARRY64", 1);
@@ -290,44 +326,6 @@ string clDefines(const Args& args, cl_device_id id, FFTConfig fft, const vector<
   return defines;
 }
 
-template<typename T>
-pair<vector<T>, vector<T>> split(const vector<T>& v, const vector<u32>& select) {
-  vector<T> a;
-  vector<T> b;
-  auto selIt = select.begin();
-  u32 selNext = selIt == select.end() ? u32(-1) : *selIt;
-  for (u32 i = 0; i < v.size(); ++i) {
-    if (i == selNext) {
-      b.push_back(v[i]);
-      ++selIt;
-      selNext = selIt == select.end() ? u32(-1) : *selIt;
-    } else {
-      a.push_back(v[i]);
-    }
-  }
-  return {a, b};
-}
-
-RoeInfo roeStat(const vector<float>& roe) {
-  double sumRoe = 0;
-  double sum2Roe = 0;
-  double maxRoe = 0;
-
-  for (auto xf : roe) {
-    double x = xf;
-    assert(x >= 0);
-    maxRoe = max(x, maxRoe);
-    sumRoe  += x;
-    sum2Roe += x * x;
-  }
-  u32 n = roe.size();
-
-  double sdRoe = sqrt(n * sum2Roe - sumRoe * sumRoe) / n;
-  double meanRoe = sumRoe / n;
-
-  return {n, maxRoe, meanRoe, sdRoe};
-}
-
 class IterationTimer {
   Timer timer;
   u32 kStart;
@@ -361,6 +359,17 @@ u32 checkStepForErrors(u32 blockSize, u32 nErrors) {
   return nErrors ? step / 2 : step;
 }
 
+// The check step that minimizes the expected cost per iteration for an error rate p (per iteration): a check costs
+// about blockSize squarings, and an error loses on average half a check step. The optimum is sqrt(2 * blockSize / p),
+// kept within 1/4x .. 4x the default step and rounded to a multiple of logStep. After an error in the current test
+// it is not above checkStepForErrors(), whatever the history.
+u32 adaptiveCheckStep(u32 blockSize, u32 logStep, double p, u32 nErrors) {
+  u32 base = baseCheckStep(blockSize);
+  double step = std::clamp(sqrt(2 * blockSize / p), base / 4.0, base * 4.0);
+  if (nErrors) { step = std::min(step, double(checkStepForErrors(blockSize, nErrors))); }
+  return std::max(logStep, u32(step / logStep + 0.5) * logStep);
+}
+
 string toHex(u32 x) {
   char buf[16];
   snprintf(buf, sizeof(buf), "%08x", x);
@@ -386,10 +395,17 @@ unique_ptr<Gpu> Gpu::make(Queue* q, u32 E, GpuCommon shared, FFTConfig fftConfig
 Gpu::~Gpu() {
   // Background tasks may have captured *this*, so wait until those are complete before destruction
   background->waitEmpty();
+
+  // The buffers go back to the shared pool, where another worker may pick them up; don't leave work in flight on them.
+  try {
+    queue->finish();
+  } catch (...) {}
 }
 
 #define ROE_SIZE 100000
 #define CARRY_SIZE 100000
+// Without -roe, the iterations per check step that run the ROE kernel variants (spread by roeStride).
+#define ROE_SAMPLES 4000
 
 Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>& extraConf, bool logFftSize) :
   queue(q),
@@ -419,6 +435,10 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
 
   K(kCarryFusedLL,     "carryfused.cl", "carryFused", WIDTH * (BIG_H + 1) / nW, "-DLL=1"),
 
+  K(kCarryFused64,    "carryfused.cl", "carryFused", WIDTH * (BIG_H + 1) / nW, "-DCARRY64=1"),
+  K(kCarryFusedROE64, "carryfused.cl", "carryFused", WIDTH * (BIG_H + 1) / nW, "-DCARRY64=1 -DROE=1"),
+  K(kCarryFusedLL64,  "carryfused.cl", "carryFused", WIDTH * (BIG_H + 1) / nW, "-DCARRY64=1 -DLL=1"),
+
   K(kCarryA,    "carry.cl", "carry", hN / CARRY_LEN),
   K(kCarryAROE, "carry.cl", "carry", hN / CARRY_LEN, "-DROE=1"),
 
@@ -455,6 +475,7 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
   // 256
   K(kernIsEqual, "etc.cl", "isEqual", 256 * 256, "-DISEQUAL=1"),
   K(sum64,       "etc.cl", "sum64",   256 * 256, "-DSUM64=1"),
+  K(roeStats,    "etc.cl", "roeStats", 256, "-DROESTATS=1 -DROE_BINS="s + to_string(RoeInfo::BINS)),
   K(testTrig,    "selftest.cl", "testTrig", 256 * 256),
   K(testFFT4, "selftest.cl", "testFFT4", 256),
   K(testFFT, "selftest.cl", "testFFT", 256),
@@ -469,10 +490,10 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
 
   weights{genWeights(E, WIDTH, BIG_H, nW, isAmdGpu(q->context->deviceId()))},
 
-  bufConstWeights{q->context, std::move(weights.weightsConstIF)},
-  bufWeights{q->context,      std::move(weights.weightsIF)},
-  bufBits{q->context,         std::move(weights.bitsCF)},
-  bufBitsC{q->context,        std::move(weights.bitsC)},
+  bufConstWeights{q->context, "weights", std::move(weights.weightsConstIF)},
+  bufWeights{q->context,      "weights", std::move(weights.weightsIF)},
+  bufBits{q->context,         "weights", std::move(weights.bitsCF)},
+  bufBitsC{q->context,        "weights", std::move(weights.bitsC)},
 
 #define BUF(name, ...) name{profile.make(#name), queue, __VA_ARGS__}
 
@@ -490,6 +511,9 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
   BUF(bufTrue,       1),
   BUF(bufROE, ROE_SIZE),
   BUF(bufStatsCarry, CARRY_SIZE),
+  BUF(bufROEStats, 2 * (4 + RoeInfo::BINS)),
+  BUF(bufROEMulPos, ROE_SIZE),
+  BUF(bufSumCheck, args.sumCheck ? 1 + 2 * SUM_SIZE + 2 * (BIG_H + 1) : 1),
 
   // Allocate extra for padding.  We can probably tighten up the amount of extra memory allocated.
   // The worst case seems to be MIDDLE=4, PAD_SIZE=512
@@ -499,7 +523,10 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
   BUF(buf3, N + total_padding),
 #undef BUF
 
+  hostStaging{queue, N},
+
   statsBits{u32(args.value("STATS", 0))},
+  errorHistory{"error-history.txt", getDeviceKey(q->context->deviceId())},
   timeBufVect{profile.make("proofBufVect")}
 {    
 
@@ -521,14 +548,27 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
 
   useLongCarry = useLongCarry || (bitsPerWord < 12.0);
 
+  adaptiveCarry = isAdaptiveCarry(mergedConfig(args, fft, extraConf), fft, E);
+  if (adaptiveCarry) {
+    statsBits |= 1;
+    if (logFftSize) { log("Adaptive CARRY32/CARRY64 (%.2f bpw, CARRY32 limit %.2f)\n", bitsPerWord, fft.shape.carry32BPW()); }
+  }
+
   if (useLongCarry) { log("Using long carry!\n"); }
   
-  for (Kernel* k : {&kCarryFused, &kCarryFusedROE, &kCarryFusedMul, &kCarryFusedMulROE, &kCarryFusedLL}) {
+  for (Kernel* k : {&kCarryFused, &kCarryFusedROE, &kCarryFusedMul, &kCarryFusedMulROE, &kCarryFusedLL,
+                    &kCarryFused64, &kCarryFusedROE64, &kCarryFusedLL64}) {
     k->setFixedArgs(3, bufCarry, bufReady, bufTrigW, bufBits, bufConstWeights, bufWeights);
   }
 
-  for (Kernel* k : {&kCarryFusedROE, &kCarryFusedMulROE})           { k->setFixedArgs(9, bufROE); }
-  for (Kernel* k : {&kCarryFused, &kCarryFusedMul, &kCarryFusedLL}) { k->setFixedArgs(9, bufStatsCarry); }
+  for (Kernel* k : {&kCarryFusedROE, &kCarryFusedMulROE, &kCarryFusedROE64}) { k->setFixedArgs(9, bufROE); }
+  for (Kernel* k : {&kCarryFused, &kCarryFusedMul, &kCarryFusedLL, &kCarryFused64, &kCarryFusedLL64}) {
+    k->setFixedArgs(9, bufStatsCarry);
+  }
+  for (Kernel* k : {&kCarryFused, &kCarryFusedROE, &kCarryFusedMul, &kCarryFusedMulROE, &kCarryFusedLL,
+                    &kCarryFused64, &kCarryFusedROE64, &kCarryFusedLL64}) {
+    k->setFixedArgs(10, bufSumCheck);
+  }
 
   for (Kernel* k : {&kCarryA, &kCarryAROE, &kCarryM, &kCarryMROE, &kCarryLL}) {
     k->setFixedArgs(3, bufCarry, bufBitsC, bufWeights);
@@ -554,65 +594,178 @@ Gpu::Gpu(Queue* q, GpuCommon shared, FFTConfig fft, u32 E, const vector<KeyVal>&
   bufReady.zero();
   bufROE.zero();
   bufStatsCarry.zero();
+  bufSumCheck.zero();
   bufTrue.write({1});
 
+  // The estimate is what Task checks against the available memory before making a Gpu; keep it honest.
+  AllocTrac::Footprint expected = estimateFootprint(args, q->context->deviceId(), fft, E), actual = footprint();
+  expected[AllocTrac::PROOF] = 0;
+  if (expected != actual) {
+    log("Warning: GPU alloc estimate%s differs from the actual%s\n",
+        AllocTrac::format(expected).c_str(), AllocTrac::format(actual).c_str());
+  }
+  assert(expected == actual);
+
+  // What this Gpu did not take from the pool is of a previous FFT size.
+  queue->context->pool()->trim();
+
   if (args.verbose) {
     selftestTrig();
+    measureTransferSpeed();
+    log("%s\n", queue->context->pool()->stats().c_str());
   }
 
   queue->finish();
 }
 
-#if 0
+// Compare the residue-sized transfer throughput to and from pageable (vector) vs. pinned (HostBuffer) host memory.
 void Gpu::measureTransferSpeed() {
-  u32 SIZE_MB = 16;
-  vector<double> data(SIZE_MB * 1024 * 1024, 1);
-  Buffer<double> buf{profile.make("DMA"), queue, SIZE};
-
+  const int reps = 8;
+  const double GB = double(N) * sizeof(int) * reps / (1024 * 1024 * 1024);
+  vector<int> data(N);
   Timer t;
-  for (int i = 0; i < 4; ++i) {
-    buf.write(data);
-    log("buffer Write : %f GB/s\n", double(SIZE / 1024 / 1024) * sizeof(double) / (1024 * t.reset()));
-  }
 
-  for (int i = 0; i < 4; ++i) {
-    buf.read(data);
-    // queue->finish();
-    log("buffer READ : %f GB/s\n", double(SIZE / 1024 / 1024) * sizeof(double) / (1024 * t.reset()));
-  }
-
-  queue->finish();
+  for (int i = 0; i < reps; ++i) { bufAux.write(data); }
+  double writeVect = t.reset();
+  for (int i = 0; i < reps; ++i) { bufAux.read(data); }
+  double readVect = t.reset();
+  for (int i = 0; i < reps; ++i) { bufAux.write(hostStaging.data(), N); }
+  double writePinned = t.reset();
+  for (int i = 0; i < reps; ++i) { bufAux.read(hostStaging.data(), N); }
+  double readPinned = t.reset();
+
+  log("Transfer %s words: write %.1f GB/s (pinned %.1f), read %.1f GB/s (pinned %.1f)\n",
+      numberK(N).c_str(), GB / writeVect, GB / writePinned, GB / readVect, GB / readPinned);
+}
+
+AllocTrac::Footprint Gpu::estimateFootprint(const Args& args, cl_device_id id, FFTConfig fft, u32 E) {
+  bool tail_single_wide, tail_single_kernel;
+  u32 tail_trigs, pad_size;
+  cppConfig(mergedConfig(args, fft, {}), id, tail_single_wide, tail_single_kernel, tail_trigs, pad_size);
+
+  const size_t N = fft.shape.size();
+  const size_t WIDTH = fft.shape.width, SMALL_H = fft.shape.height, MIDDLE = fft.shape.middle;
+  const size_t groupWidth = WIDTH / fft.shape.nW();
+  const size_t D = sizeof(double), I = sizeof(int), D2 = 2 * sizeof(double);
+
+  AllocTrac::Footprint f{};
+  f[AllocTrac::DATA]  = 2 * N * I;
+  f[AllocTrac::CHECK] = 2 * N * I;
+  f[AllocTrac::CARRY] = (N / 2 + WIDTH) * sizeof(i64) + (N / 2 + WIDTH) / 32 * I + (ROE_SIZE + CARRY_SIZE) * sizeof(float)
+    + ROE_SIZE * sizeof(u32) + 2 * (4 + RoeInfo::BINS) * sizeof(double);
+  f[AllocTrac::TEMP]  = 3 * (N + total_padding) * D;
+  f[AllocTrac::WEIGHTS] = ((isAmdGpu(id) ? 0 : 2 * groupWidth) + 2 * groupWidth + 2 * SMALL_H * MIDDLE) * D + 2 * (N / 32) * sizeof(u32);
+
+  size_t trig = 5 * WIDTH + 5 * SMALL_H + (MIDDLE == 1 ? 1 : SMALL_H + WIDTH);
+  size_t tailLines = WIDTH * MIDDLE / 2 * (tail_single_wide ? 1 : 2);
+  if (tail_trigs == 1) { trig += SMALL_H / fft.shape.nH() + tailLines; }
+  if (tail_trigs == 0) { trig += tailLines * (SMALL_H / fft.shape.nH()); }
+  f[AllocTrac::TRIG] = trig * D2;
+
+  f[AllocTrac::PROOF] = args.getProofPow(E) * N * I;
+  size_t sumCheck = args.sumCheck ? 1 + 2 * SUM_SIZE + 2 * (SMALL_H * MIDDLE + 1) : 1;
+  f[AllocTrac::OTHER] = 256 * I + sizeof(u64) + I + sumCheck * D + N * I; // the last is hostStaging
+  return f;
+}
+
+AllocTrac::Footprint Gpu::footprint() const {
+  AllocTrac::Footprint f{};
+  for (const TrigPtr& p : {bufTrigW, bufTrigH, bufTrigM}) { p->addTo(f); }
+  bufConstWeights.addTo(f);
+  bufWeights.addTo(f);
+  bufBits.addTo(f);
+  bufBitsC.addTo(f);
+  for (const Buffer<int>* b : {&bufData, &bufAux, &bufCheck, &bufBase, &bufReady, &bufSmallOut, &bufTrue}) { b->addTo(f); }
+  bufCarry.addTo(f);
+  bufSumOut.addTo(f);
+  bufROE.addTo(f);
+  bufStatsCarry.addTo(f);
+  bufROEStats.addTo(f);
+  bufROEMulPos.addTo(f);
+  bufSumCheck.addTo(f);
+  for (const Buffer<double>* b : {&buf1, &buf2, &buf3}) { b->addTo(f); }
+  hostStaging.addTo(f);
+  return f;
 }
-#endif
 
 u32 Gpu::updateCarryPos(u32 bit) {
-  return (statsBits & bit) && (carryPos < CARRY_SIZE) ? carryPos++ : carryPos;
+  // Once the buffer is full, keep accumulating (as max) into the last slot.
+  return !(statsBits & bit) ? carryPos : carryPos < CARRY_SIZE ? carryPos++ : CARRY_SIZE - 1;
 }
 
 void Gpu::carryFused(Buffer<double>& a, Buffer<double>& b) {
   assert(roePos <= ROE_SIZE);
-  roePos < wantROE ? kCarryFusedROE(a, b, roePos++)
-                   : kCarryFused(a, b, updateCarryPos(1 << 0));
+  if (args.sumCheck) { ++sumPos; }
+  if (useCarry64) {
+    ++carry64Its;
+    sampleROE() ? kCarryFusedROE64(a, b, roePos++)
+                     : kCarryFused64(a, b, updateCarryPos(1 << 0));
+  } else {
+    ++carry32Its;
+    sampleROE() ? kCarryFusedROE(a, b, roePos++)
+                     : kCarryFused(a, b, updateCarryPos(1 << 0));
+  }
+}
+
+void Gpu::carryFusedLL(Buffer<double>& a, Buffer<double>& b) {
+  if (args.sumCheck) { ++sumPos; }
+  if (useCarry64) {
+    ++carry64Its;
+    kCarryFusedLL64(a, b, updateCarryPos(1 << 0));
+  } else {
+    ++carry32Its;
+    kCarryFusedLL(a, b, updateCarryPos(1 << 0));
+  }
+}
+
+// With adaptive carry, switch to CARRY64 as soon as the carries get close to the CARRY32 limit, and back to CARRY32
+// once they are well below it. The carry stats map abs(carry) == 2^31, the CARRY32 limit, to 0.5.
+void Gpu::updateCarryMode(const RoeInfo& carryStats) {
+  if (!adaptiveCarry || carryStats.N < 2) { return; }
+
+  double z = carryStats.z();
+  if (!useCarry64 && (carryStats.max > 0.35 || z < 26)) {
+    useCarry64 = true;
+    log("Carry max %.3f Z=%.1f, switching to CARRY64\n", carryStats.max, z);
+  } else if (useCarry64 && carryStats.max < 0.25 && z > 32) {
+    useCarry64 = false;
+    log("Carry max %.3f Z=%.1f, switching to CARRY32\n", carryStats.max, z);
+  }
 }
 
 void Gpu::carryFusedMul(Buffer<double>& a, Buffer<double>& b) {
   assert(roePos <= ROE_SIZE);
-  roePos < wantROE ? kCarryFusedMulROE(a, b, roePos++)
+  if (args.sumCheck) { ++sumPos; }
+  sampleROE() ? kCarryFusedMulROE(a, b, roePos++)
                    : kCarryFusedMul(a, b, updateCarryPos(1 << 1));
 }
 
-void Gpu::carryA(Buffer<int>& a, Buffer<double>& b) {
+bool Gpu::sampleROE() {
+  if (roePos >= wantROE || ++roeTick < roeStride) { return false; }
+  roeTick = 0;
+  return true;
+}
+
+void Gpu::carryA(Buffer<int>& a, Buffer<double>& b, bool isMul) {
   assert(roePos <= ROE_SIZE);
-  roePos < wantROE ? kCarryAROE(a, b, roePos++)
-                   : kCarryA(a, b, updateCarryPos(1 << 2));
+  if (!sampleROE()) {
+    kCarryA(a, b, updateCarryPos(1 << 2));
+    return;
+  }
+  if (isMul) { mulRoePos.push_back(roePos); }
+  kCarryAROE(a, b, roePos++);
 }
 
 void Gpu::carryLL(Buffer<int>& a, Buffer<double>& b) { kCarryLL(a, b, updateCarryPos(1 << 2)); }
 
-void Gpu::carryM(Buffer<int>& a, Buffer<double>& b) {
+void Gpu::carryM(Buffer<int>& a, Buffer<double>& b, bool isMul) {
   assert(roePos <= ROE_SIZE);
-  roePos < wantROE ? kCarryMROE(a, b, roePos++)
-                   : kCarryM(a, b, updateCarryPos(1 << 3));
+  if (!sampleROE()) {
+    kCarryM(a, b, updateCarryPos(1 << 3));
+    return;
+  }
+  if (isMul) { mulRoePos.push_back(roePos); }
+  kCarryMROE(a, b, roePos++);
 }
 
 vector<Buffer<i32>> Gpu::makeBufVector(u32 size) {
@@ -621,52 +774,105 @@ vector<Buffer<i32>> Gpu::makeBufVector(u32 size) {
   return r;
 }
 
+// Reduce the per-iteration maxima [from, n) in buf on the device, which also zeroes them; only the two small
+// records (squarings, multiplications) are read back.
+pair<RoeInfo, RoeInfo> Gpu::reduceStats(Buffer<float>& buf, u32 from, u32 n, const vector<u32>& mulPos) {
+  auto begin = std::lower_bound(mulPos.begin(), mulPos.end(), from);
+  auto end = std::lower_bound(begin, mulPos.end(), n);
+  u32 nMul = end - begin;
+  if (nMul) { bufROEMulPos.write(&*begin, nMul); }
+  roeStats(bufROEStats, buf, from, n, bufROEMulPos, nMul);
+  vector<double> records = bufROEStats.read();
+  return {RoeInfo::fromRecord(records.data()), RoeInfo::fromRecord(records.data() + 4 + RoeInfo::BINS)};
+}
+
 pair<RoeInfo, RoeInfo> Gpu::readROE() {
   assert(roePos <= ROE_SIZE);
-  if (roePos) {
-    vector<float> roe = bufROE.read(roePos);
-    assert(roe.size() == roePos);
-    bufROE.zero(roePos);
-    roePos = 0;
-    auto [squareRoe, mulRoe] = split(roe, mulRoePos);
-    mulRoePos.clear();
-    return {roeStat(squareRoe), roeStat(mulRoe)};
-  } else {
-    return {};
+  pair<RoeInfo, RoeInfo> ret{std::move(roeSqPending), std::move(roeMulPending)};
+  roeSqPending = roeMulPending = {};
+  if (roePos > roeReduced) {
+    auto [sq, mul] = reduceStats(bufROE, roeReduced, roePos, mulRoePos);
+    ret = {RoeInfo::merge(ret.first, sq), RoeInfo::merge(ret.second, mul)};
+  }
+  roePos = roeReduced = 0;
+  mulRoePos.clear();
+  return ret;
+}
+
+/* Read the ROE sampled since the last read, keeping it for the next readROE(); true if its max is above threshold.
+   roePos is not reset, so reading early does not add to the iterations sampled per check step (wantROE). */
+bool Gpu::roeSpike(double threshold) {
+  bool spike = false;
+  if (roePos > roeReduced) {
+    auto [sq, mul] = reduceStats(bufROE, roeReduced, roePos, mulRoePos);
+    roeReduced = roePos;
+    roeSqPending = RoeInfo::merge(roeSqPending, sq);
+    roeMulPending = RoeInfo::merge(roeMulPending, mul);
+    spike = spike || std::max(sq.max, mul.max) > threshold;
+  }
+  return spike;
+}
+
+// For testing the error recovery: a word far out of range makes the next squaring overflow the double precision,
+// a real ROE spike. That iteration is sampled: a one-off spike is otherwise seen only if it falls on a sampled one.
+void Gpu::injectError() {
+  int word = 1 << 30;
+  bufData.write(&word, 1);
+  wantROE = std::max(wantROE, std::min(roePos + 1, u32(ROE_SIZE)));
+  roeTick = roeStride;
+}
+
+// The SUMINP/SUMOUT check of the carryFused squarings since the last call: the sum of the inverse FFT output must be
+// the square of the sum of the forward FFT input, times the FFT scale. The scale is taken as the median ratio over
+// the iterations with a large input sum. True if any iteration is off by more than SUM_TOLERANCE.
+bool Gpu::sumMismatch() {
+  if (!sumPos) { return false; }
+  u32 n = std::min(sumPos, u32(SUM_SIZE));
+  vector<double> records = bufSumCheck.read(1 + 2 * n);
+  double zero = 0;
+  bufSumCheck.write(&zero, 1);
+  vector<u32> chained = std::move(sumChained);
+  sumChained.clear();
+  sumPos = 0;
+
+  // {sumIn^2, sumOut} with the sumIn of the previous iteration; record i is {sumOut, sumIn} at 1 + 2 * i.
+  vector<pair<double, double>> sums;
+  for (u32 i : chained) {
+    if (i > 0 && i < n) { sums.push_back({records[2 * i] * records[2 * i], records[1 + 2 * i]}); }
+  }
+  if (sums.size() < 16) { return false; }
+
+  auto median = [](vector<double> v) {
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+  };
+
+  vector<double> in2;
+  for (auto [a, b] : sums) { in2.push_back(a); }
+  double typical = median(in2);
+  if (!(typical > 0)) { return false; }
+
+  vector<double> ratios;
+  for (auto [a, b] : sums) { if (a >= typical) { ratios.push_back(b / a); } }
+  double scale = median(ratios);
+
+  u32 nBad = 0;
+  double worst = 0;
+  for (auto [a, b] : sums) {
+    double err = fabs(b - scale * a) / fabs(scale * typical);
+    // NaN counts as a mismatch
+    if (!(err <= SUM_TOLERANCE)) { ++nBad; }
+    if (!(err <= worst)) { worst = err; }
   }
+  if (nBad) { log("SUMINP/SUMOUT mismatch in %u of %u iterations, max %g\n", nBad, u32(sums.size()), worst); }
+  return nBad;
 }
 
 RoeInfo Gpu::readCarryStats() {
   assert(carryPos <= CARRY_SIZE);
   if (carryPos == 0) { return {}; }
-  vector<float> carry = bufStatsCarry.read(carryPos);
-  assert(carry.size() == carryPos);
-  bufStatsCarry.zero(carryPos);
+  RoeInfo ret = reduceStats(bufStatsCarry, 0, carryPos, {}).first;
   carryPos = 0;
-
-  RoeInfo ret = roeStat(carry);
-
-#if 0
-  log("%s\n", ret.toString().c_str());
-
-  std::sort(carry.begin(), carry.end());
-  File fo = File::openAppend("carry.txt");
-  auto it = carry.begin();
-  u32 n = carry.size();
-  u32 c = 0;
-  for (int i=0; i < 500; ++i) {
-    double y = 0.23 + (0.48 - 0.23) / 500 * i;
-    while (it < carry.end() && *it < y) {
-      ++c;
-      ++it;
-    }
-    fo.printf("%f %f\n", y, c / double(n));
-  }
-
-  // for (auto x : carry) { fo.printf("%f\n", x); }
-  fo.printf("\n\n");
-#endif
-
   return ret;
 }
 
@@ -675,6 +881,7 @@ static bool isAllZero(vector<T> v) { return std::all_of(v.begin(), v.end(), [](T
 
 // Read from GPU, verifying the transfer with a sum, and retry on failure.
 vector<int> Gpu::readChecked(Buffer<int>& buf) {
+  HostOp op{"readChecked"};
   for (int nRetry = 0; nRetry < 3; ++nRetry) {
     sum64(bufSumOut, u32(buf.size * sizeof(int)), buf);
 
@@ -713,13 +920,9 @@ void Gpu::mul(Buffer<int>& ioA, Buffer<double>& inB, Buffer<double>& tmp1, Buffe
     fftP(tmp1, ioA);
     fftMidIn(tmp2, tmp1);
     tailMul(tmp1, inB, tmp2);
-
-    // Register the current ROE pos as multiplication (vs. a squaring)
-    if (mulRoePos.empty() || mulRoePos.back() < roePos) { mulRoePos.push_back(roePos); }
-
     fftMidOut(tmp2, tmp1);
     fftW(tmp1, tmp2);
-    if (mul3) { carryM(ioA, tmp1); } else { carryA(ioA, tmp1); }
+    if (mul3) { carryM(ioA, tmp1, true); } else { carryA(ioA, tmp1, true); }
     carryB(ioA);
 }
 
@@ -771,6 +974,11 @@ bool Gpu::doCheck(u32 blockSize) {
 }
 
 void Gpu::logTimeKernels() {
+  if (args.verbose) {
+    auto [nSet, nSkip] = Kernel::argStats();
+    log("Kernel args: %" PRIu64 " set, %" PRIu64 " unchanged\n", nSet, nSkip);
+  }
+
   auto prof = profile.get();
   u64 total = 0;
   for (const TimeInfo* p : prof) { total += p->times[2]; }
@@ -785,7 +993,8 @@ void Gpu::logTimeKernels() {
     assert(n);
     double f = 1e-3 / n;
     double percent = 100.0 / total * p->times[2];
-    if (!args.verbose && percent < 0.2) { break; }
+    JsonLog::event("kernel", {{"name", p->name}, {"percent", percent}, {"usPerCall", p->times[2] * f}, {"calls", n}});
+    if (!args.verbose && percent < 0.2) { continue; }
     snprintf(buf, sizeof(buf),
              args.verbose ? "%s %5.2f%% %-11s : %6.0f us/call x %5d calls  (%.3f %.0f)\n"
                           : "%s %5.2f%% %-11s %4.0f x%6d  %.3f %.0f\n",
@@ -796,17 +1005,22 @@ void Gpu::logTimeKernels() {
   log("%s", s.c_str());
   // log("Total time %.3fs\n", total * 1e-9);
   profile.reset();
+
+  if (string gaps = queue->idleReport(); !gaps.empty()) { log("%s", gaps.c_str()); }
 }
 
 vector<int> Gpu::readOut(Buffer<int> &buf) {
   transpOut(bufAux, buf);
-  return bufAux.read();
+  bufAux.read(hostStaging.data(), N);
+  return {hostStaging.begin(), hostStaging.end()};
 }
 
 void Gpu::writeIn(Buffer<int>& buf, const vector<u32>& words) { writeIn(buf, expandBits(words, N, E)); }
 
 void Gpu::writeIn(Buffer<int>& buf, vector<i32>&& words) {
-  bufAux.write(std::move(words));
+  assert(words.size() == N);
+  std::copy(words.begin(), words.end(), hostStaging.begin());
+  bufAux.write(hostStaging.data(), N);
   transpIn(buf, bufAux);
 }
 
@@ -922,6 +1136,9 @@ void Gpu::square(Buffer<int>& out, Buffer<int>& in, bool leadIn, bool leadOut, b
     assert(!useLongCarry);
     assert(!doMul3);
 
+    // Without leadIn, the input of this FFT is the output of the previous carryFused: the SUMINP/SUMOUT check applies.
+    if (args.sumCheck && !leadIn && sumPos < SUM_SIZE) { sumChained.push_back(sumPos); }
+
     if (doLL) {
       carryFusedLL(buf2, buf1);
     } else {
@@ -993,6 +1210,52 @@ static string getETA(u32 step, u32 total, float secsPerStep) {
   return formatETA(etaSecs);
 }
 
+double RoeInfo::zCI(double x) const {
+  if (N < 2) { return 0; }
+  // Var(z) * N = pi^2/6 + 1.1 * (z - gamma)^2 + 1.46 * (z - gamma), where gamma is the Euler-Mascheroni constant.
+  double d = z(x) - 0.577215664901533;
+  return 1.96 * sqrt(std::max(0.0, 1.6449 + 1.1 * d * d + 1.4616 * d) / N);
+}
+
+RoeInfo RoeInfo::merge(const RoeInfo& a, const RoeInfo& b) {
+  if (!a.N) { return b; }
+  if (!b.N) { return a; }
+  u32 n = a.N + b.N;
+  double mean = (a.mean * a.N + b.mean * b.N) / n;
+  // Combine the second moments around the new mean
+  double m2 = a.N * (a.sd * a.sd + (a.mean - mean) * (a.mean - mean)) + b.N * (b.sd * b.sd + (b.mean - mean) * (b.mean - mean));
+  RoeInfo ret{n, std::max(a.max, b.max), mean, sqrt(m2 / n)};
+  for (u32 i = 0; i < BINS; ++i) { ret.hist[i] = a.hist[i] + b.hist[i]; }
+  return ret;
+}
+
+RoeInfo RoeInfo::fromRecord(const double* record) {
+  u32 n = record[0];
+  if (!n) { return {}; }
+  double sum = record[2];
+  double sum2 = record[3];
+  RoeInfo ret{n, record[1], sum / n, sqrt(std::max(0.0, n * sum2 - sum * sum)) / n};
+  for (u32 i = 0; i < BINS; ++i) { ret.hist[i] = record[4 + i]; }
+  return ret;
+}
+
+double RoeInfo::quantile(double p) const {
+  if (!N) { return 0; }
+  double want = p * N;
+  double seen = 0;
+  for (u32 i = 0; i < BINS; ++i) {
+    if (hist[i] && seen + hist[i] >= want) { return (i + (want - seen) / hist[i]) * (0.5 / BINS); }
+    seen += hist[i];
+  }
+  return max;
+}
+
+string RoeInfo::histogramString() const {
+  string s;
+  for (u32 i = 0; i < BINS; ++i) { s += (i ? " "s : ""s) + to_string(hist[i]); }
+  return s;
+}
+
 string RoeInfo::toString() const {
   if (!N) { return {}; }
 
@@ -1002,6 +1265,23 @@ string RoeInfo::toString() const {
   return buf;
 }
 
+TimeStats TimeStats::of(vector<double> v) {
+  if (v.empty()) { return {}; }
+
+  auto median = [](vector<double>& v) {
+    auto mid = v.begin() + v.size() / 2;
+    std::nth_element(v.begin(), mid, v.end());
+    return *mid;
+  };
+
+  double m = median(v);
+  for (double& x : v) { x = fabs(x - m); }
+  double mad = 1.4826 * median(v);
+
+  // More than 2% spread between sub-samples means the GPU was not in a steady state (clocks, thermals, other load).
+  return {m, mad, u32(v.size()), mad <= 0.02 * m};
+}
+
 static string makeLogStr(const string& status, u32 k, u64 res, float secsPerIt, u32 nIters) {
   char buf[256];
   
@@ -1011,19 +1291,26 @@ static string makeLogStr(const string& status, u32 k, u64 res, float secsPerIt,
   return buf;
 }
 
-void Gpu::doBigLog(u32 k, u64 res, bool checkOK, float secsPerIt, u32 nIters, u32 nErrors) {
+RoeInfo Gpu::doBigLog(u32 k, u64 res, bool checkOK, float secsPerIt, u32 nIters, u32 nErrors) {
   auto [roeSq, roeMul] = readROE();
   double z = roeSq.z();
   zAvg.update(z, roeSq.N);
   log("%sZ=%.0f (avg %.1f)%s\n", makeLogStr(checkOK ? "OK" : "EE", k, res, secsPerIt, nIters).c_str(),
       z, zAvg.avg(), (nErrors ? " "s + to_string(nErrors) + " errors"s : ""s).c_str());
+  ++(checkOK ? checksOK : checksFailed);
+  if (roeSq.N) { lastRoe = roeSq; }
 
   if (roeSq.N > 2 && z < 20) {
     log("Danger ROE! Z=%.1f is too small, increase precision or FFT size!\n", z);
   }
 
-  // Unless ROE log is not explicitly requested, measure only a few iterations to minimize overhead
-  wantROE = args.logROE ? ROE_SIZE : 400;
+  if (args.logROE && roeSq.N) {
+    log("ROE %s p99 %.3f\nROE histogram: %s\n", roeSq.toString().c_str(), roeSq.quantile(0.99), roeSq.histogramString().c_str());
+  }
+
+  // Unless ROE log is explicitly requested, sample only part of the iterations (spread by roeStride): the ROE kernels
+  // cost a bit more. The reading back is cheap as the stats are reduced on the GPU.
+  wantROE = args.logROE ? ROE_SIZE : ROE_SAMPLES;
 
   RoeInfo carryStats = readCarryStats();
   if (carryStats.N > 2) {
@@ -1031,6 +1318,36 @@ void Gpu::doBigLog(u32 k, u64 res, bool checkOK, float secsPerIt, u32 nIters, u3
     double z = carryStats.z();
     log("Carry: %x Z(%u)=%.1f\n", m, carryStats.N, z);
   }
+  updateCarryMode(carryStats);
+  if (adaptiveCarry) {
+    log("Carry iterations: %" PRIu64 " CARRY32, %" PRIu64 " CARRY64\n", carry32Its, carry64Its);
+  }
+  JsonLog::event("check", {{"kind", "PRP"}, {"E", E}, {"k", k}, {"kEnd", nIters}, {"usPerIt", secsPerIt * 1e6},
+                           {"res64", hex(res)}, {"ok", checkOK}, {"errors", nErrors},
+                           {"roeN", roeSq.N}, {"roeMax", roeSq.N ? roeSq.max : NAN}, {"roeZ", roeSq.N ? z : NAN},
+                           {"roeZAvg", zAvg.avg()}, {"carryZ", carryStats.N > 2 ? carryStats.z() : NAN}});
+  publishMetrics("PRP", k, E, secsPerIt, getSaver()->bytesWritten());
+  return roeSq;
+}
+
+void Gpu::publishMetrics(const char* kind, u32 k, u32 kEnd, float secsPerIt, u64 savedBytes) {
+  if (!Metrics::enabled() && !Control::enabled()) { return; }
+  Metrics::update([&](WorkerMetrics& m) {
+    m = {
+      .kind = kind,
+      .exponent = E,
+      .k = k,
+      .kEnd = kEnd,
+      .usPerIt = secsPerIt * 1e6,
+      .etaSecs = k < kEnd ? (kEnd - k) * double(secsPerIt) : 0,
+      .checksOK = checksOK,
+      .checksFailed = checksFailed,
+      .roeMax = lastRoe.max,
+      .roeZ = lastRoe.N ? lastRoe.z() : 0,
+      .stallSecs = queue->stallTime(),
+      .bytesWritten = savedBytes + proofBytes,
+    };
+  });
 }
 
 bool Gpu::equals9(const Words& a) {
@@ -1265,7 +1582,7 @@ tuple<bool, RoeInfo> Gpu::measureCarry() {
   return {ok, stats};
 }
 
-tuple<bool, u64, RoeInfo, RoeInfo> Gpu::measureROE(bool quick) {
+tuple<bool, u64, RoeInfo, RoeInfo> Gpu::measureROE(bool quick, double zTolerance) {
   u32 blockSize{}, iters{}, warmup{};
 
   if (true) {
@@ -1279,8 +1596,12 @@ tuple<bool, u64, RoeInfo, RoeInfo> Gpu::measureROE(bool quick) {
   }
 
   assert(iters % blockSize == 0);
+  const u32 chunk = iters;
+  const u32 maxIters = 10 * iters;
 
   wantROE = ROE_SIZE; // should be large enough to capture fully this measureROE()
+  roeStride = 1;
+  RoeInfo roeSq, roeMul;
 
   u32 k = 0;
   PRPState state{E, 0, blockSize, 3, makeWords(E, 1), 0};
@@ -1317,7 +1638,13 @@ tuple<bool, u64, RoeInfo, RoeInfo> Gpu::measureROE(bool quick) {
     leadIn = true;
     ++k;
 
-    if (k >= iters) { break; }
+    if (k >= iters) {
+      auto [sq, mul] = readROE();
+      roeSq = RoeInfo::merge(roeSq, sq);
+      roeMul = RoeInfo::merge(roeMul, mul);
+      if (!zTolerance || roeSq.zCI() <= zTolerance || iters >= maxIters) { break; }
+      iters += chunk;
+    }
 
     modMul(bufCheck, bufData);
     if (Signal::stopRequested()) { throw "stop requested"; }
@@ -1327,25 +1654,24 @@ tuple<bool, u64, RoeInfo, RoeInfo> Gpu::measureROE(bool quick) {
   if (Signal::stopRequested()) { throw "stop requested"; }
 
   bool ok = doCheck(blockSize);
-  auto roes = readROE();
+  auto [sq, mul] = readROE();
+  roeSq = RoeInfo::merge(roeSq, sq);
+  roeMul = RoeInfo::merge(roeMul, mul);
 
   wantROE = 0;
   // log("%s %016" PRIx64 " %s\n", ok ? "OK" : "EE", res, roe.toString(statsBits).c_str());
-  return {ok, res, roes.first, roes.second};
+  return {ok, res, roeSq, roeMul};
 }
 
-double Gpu::timePRP() {
-  u32 blockSize{}, iters{}, warmup{};
+TimeStats Gpu::timePRP(u32 iters) {
+  /* Each block is one timing sub-sample. The first (partial) block follows the warm-up and is discarded too.
+     A block is timed between the completions of the markers at its ends; the next block is enqueued before waiting,
+     so the GPU does not drain between the blocks. */
+  const u32 blockSize = 100;
+  const u32 warmup = 30;
 
-  if (true) {
-    blockSize = 200;
-    iters = 1000;
-    warmup = 30;
-  } else {
-    blockSize = 1000;
-    iters = 10'000;
-    warmup = 100;
-  }
+  // Whole blocks only
+  iters = std::max(2 * blockSize, (iters + blockSize / 2) / blockSize * blockSize);
 
   assert(iters % blockSize == 0);
 
@@ -1365,9 +1691,21 @@ double Gpu::timePRP() {
   queue->finish();
   if (Signal::stopRequested()) { throw "stop requested"; }
 
+  vector<double> samples;
   Timer t;
   queue->setSquareTime(0);     // Busy wait on nVidia to get the most accurate timings while tuning
   bool leadIn = useLongCarry;
+  EventHolder pending;         // The marker at the end of the previous block
+  u32 pendingK = 0;
+
+  // Waits for the previous block and records its time.
+  auto blockDone = [&]() {
+    queue->wait(pending);
+    double secs = t.reset();
+    // The time of the first (partial) block is not a block time.
+    if (pendingK > blockSize) { samples.push_back(secs / blockSize * 1e6); }
+  };
+
   while (true) {
     while (k % blockSize < blockSize-1) {
       square(bufData, bufData, leadIn, useLongCarry);
@@ -1377,29 +1715,53 @@ double Gpu::timePRP() {
     square(bufData, bufData, useLongCarry, true);
     leadIn = true;
     ++k;
+    EventHolder marker = queue->marker();
+    if (pending) { blockDone(); }
+    pending = std::move(marker);
+    pendingK = k;
 
     if (k >= iters) { break; }
 
     modMul(bufCheck, bufData);
     if (Signal::stopRequested()) { throw "stop requested"; }
   }
-  queue->finish();
-  double secsPerIt = t.reset() / (iters - warmup);
+  blockDone();
 
   if (Signal::stopRequested()) { throw "stop requested"; }
 
+  TimeStats stats = TimeStats::of(samples);
+
   u64 res = dataResidue();
   bool ok = doCheck(blockSize);
   if (!ok) {
     log("Error %016" PRIx64 "\n", res);
-    secsPerIt = 0.1; // a large value to mark the error
+    stats = {1e5, 0, u32(samples.size()), false}; // a large value to mark the error
   }
-  return secsPerIt * 1e6;
+  return stats;
 }
 
-PRPResult Gpu::isPrimePRP(const Task& task) {
+// At a stop point: a "reload" control request goes on with the next task, any other stop ends the worker.
+[[noreturn]] static void throwStop(u32 ctl) {
+  if ((ctl & Control::RELOAD) && !(ctl & Control::STOP) && !Signal::stopRequested()) {
+    Control::done(Control::RELOAD);
+    throw ReloadRequest{};
+  }
+  throw "stop requested";
+}
+
+PRPResult Gpu::isPrimePRP(const Task& task, bool canGrow, bool canShrink) {
   assert(E == task.exponent);
 
+  // The ROE samples over which to decide an FFT switch.
+  const u32 MIGRATE_SAMPLES = 20'000;
+  RoeInfo roeWindow;
+
+  // The checks triggered early by a ROE spike, the errors they found, and the iterations that were not wasted
+  // (until the regular check) for those errors.
+  u32 nSpikeChecks = 0, nSpikeErrors = 0;
+  u64 spikeItersSaved = 0;
+  bool injected = false;
+
   // This timer is used to measure total elapsed time to be written to the savefile.
   Timer elapsedTimer;
 
@@ -1424,7 +1786,17 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
   assert(blockSize > 0 && logStep % blockSize == 0);
 
   u32 checkStep = checkStepForErrors(blockSize, nErrors);
+  if (args.adaptiveCheck) {
+    double p = errorHistory.rate();
+    auto [histIters, histErrors] = errorHistory.get();
+    checkStep = adaptiveCheckStep(blockSize, logStep, p, nErrors);
+    log("Check step %u from %.1f errors in %.3g recent iterations, %u in this test: overhead %.3f%%, "
+        "expected lost work %.3f%%\n", checkStep, histErrors, histIters, nErrors,
+        100.0 * blockSize / checkStep, 100 * p * (checkStep / 2.0 + blockSize));
+  }
   assert(checkStep % logStep == 0);
+  u32 lastCheckK = k;
+  roeStride = args.logROE ? 1 : std::max(1u, checkStep / ROE_SAMPLES);
 
   u32 power = getProofPower(k);
   
@@ -1461,7 +1833,7 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
   while (true) {
     assert(k < kEndEnd);
     
-    if (!wantROE && k - startK > 30) { wantROE = args.logROE ? ROE_SIZE : 2'000; }
+    if (!wantROE && k - startK > 30) { wantROE = args.logROE ? ROE_SIZE : ROE_SAMPLES; }
 
     if (skipNextCheckUpdate) {
       skipNextCheckUpdate = false;
@@ -1472,7 +1844,10 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
 
     ++k; // !! early inc
 
-    bool doStop = (k % blockSize == 0) && (Signal::stopRequested() || (args.iters && k - startK >= args.iters));
+    // The control requests are read where Ctrl-C is, at the block ends.
+    u32 ctl = (k % blockSize == 0) ? Control::pending() : 0;
+    bool doStop = (k % blockSize == 0)
+      && (Signal::stopRequested() || (ctl & (Control::STOP | Control::RELOAD)) || (args.iters && k - startK >= args.iters));
     bool leadOut = (k % blockSize == 0) || k == persistK || k == kEnd || useLongCarry;
 
     assert(!doStop || leadOut);
@@ -1488,7 +1863,11 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
         ++nErrors;
         goto reload;
       }
-      (*background)([=, E=this->E] { ProofSet::save(E, power, k, compactBits(rawData, E)); });
+      (*background)([=, E=this->E, this] {
+        Words words = compactBits(rawData, E);
+        ProofSet::save(E, power, k, words);
+        proofBytes += words.size() * sizeof(u32);
+      });
       persistK = proofSet.next(k);
     }
 
@@ -1503,13 +1882,32 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
       log("%s %8d / %d, %s\n", isPrime ? "PP" : "CC", kEnd, E, hex(finalRes64).c_str());
     }
 
-    bool doCheck = doStop || (k % checkStep == 0) || (k >= kEndEnd) || (k - startK == 2 * blockSize);
+    if (args.injectErrorK && leadOut && k >= args.injectErrorK && !injected) {
+      injected = true;
+      log("Injecting an error at %u\n", k);
+      injectError();
+    }
+
+    bool doCheck = doStop || (ctl & Control::SAVE) || (k % checkStep == 0) || (k >= kEndEnd) || (k - startK == 2 * blockSize);
     bool doLog = k % logStep == 0;
 
     if (!leadOut || (!doCheck && !doLog)) continue;
 
     assert(doCheck || doLog);
 
+    // A round-off spike or a SUMINP/SUMOUT mismatch is a likely error: check now instead of at the end of the check step.
+    bool isSumError = sumMismatch();
+    bool isSpikeCheck = !doCheck && (isSumError || (args.roeSpike && roeSpike(args.roeSpike)));
+    if (isSpikeCheck) {
+      if (isSumError) {
+        log("%9u SUMINP/SUMOUT mismatch, checking early\n", k);
+      } else {
+        log("%9u ROE spike above %.2f, checking early\n", k, args.roeSpike);
+      }
+      doCheck = true;
+      ++nSpikeChecks;
+    }
+
     u64 res = dataResidue();
     float secsPerIt = iterationTimer.reset(k);
     queue->setSquareTime((int) (secsPerIt * 1'000'000));
@@ -1535,9 +1933,17 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
         double z = carryStats.z();
         log("Carry: %x Z(%u)=%.1f\n", m, carryStats.N, z);
       }
+      updateCarryMode(carryStats);
+      JsonLog::event("progress", {{"kind", "PRP"}, {"E", E}, {"k", k}, {"kEnd", kEndEnd}, {"usPerIt", secsPerIt * 1e6},
+                                  {"res64", hex(res)}, {"carryZ", carryStats.N ? carryStats.z() : NAN}});
+      publishMetrics("PRP", k, E, secsPerIt, getSaver()->bytesWritten());
     } else {
       bool ok = this->doCheck(blockSize);
       [[maybe_unused]] float secsCheck = iterationTimer.reset(k);
+      if (args.adaptiveCheck) {
+        errorHistory.add(k - lastCheckK, !ok);
+        lastCheckK = k;
+      }
 
       if (ok) {
         nSeqErrors = 0;
@@ -1549,15 +1955,44 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
             getSaver()->save({E, k, blockSize, res, compactBits(rawCheck, E), nErrors, elapsedBefore + elapsedTimer.at()});
           });
         }
+        if (ctl & Control::SAVE) { Control::done(Control::SAVE); }
 
-        doBigLog(k, res, ok, secsPerIt, kEndEnd, nErrors);
+        RoeInfo roe = doBigLog(k, res, ok, secsPerIt, kEndEnd, nErrors);
           
         if (k >= kEndEnd) {
+          if (nSpikeChecks) {
+            log("Early checks (ROE spike, SUMINP/SUMOUT): %u, errors found %u, iterations saved %" PRIu64 "\n",
+                nSpikeChecks, nSpikeErrors, spikeItersSaved);
+          }
           fs::path proofFile = saveProof(args, proofSet);
           return {isPrime, finalRes64, nErrors, proofFile.string(), toHex(res2048)};
-        }        
+        }
+
+        if ((canGrow || canShrink) && k < kEnd && !doStop) {
+          roeWindow = RoeInfo::merge(roeWindow, roe);
+          if (roeWindow.N >= MIGRATE_SAMPLES) {
+            double z = roeWindow.z();
+            double ci = roeWindow.zCI();
+            int migrate = (canGrow && z + ci < args.migrateLowZ) ? 1 : (canShrink && z - ci > args.migrateHighZ) ? -1 : 0;
+            if (migrate) {
+              log("Z=%.1f +- %.1f over %u iterations, switching to a %s FFT\n",
+                  z, ci, roeWindow.N, migrate > 0 ? "larger" : "smaller");
+              // The new FFT continues from the savefile just written
+              background->waitEmpty();
+              return {.nErrors = nErrors, .migrate = migrate, .k = k, .z = z};
+            }
+            roeWindow = {};
+          }
+        }
       } else {
         ++nErrors;
+        if (isSpikeCheck) {
+          // Without the spike, the error would have been found only at the next regular check.
+          u32 saved = std::min(roundUp(k, checkStep), kEndEnd) - k;
+          ++nSpikeErrors;
+          spikeItersSaved += saved;
+          log("Early check found the error, %u iterations saved\n", saved);
+        }
         doBigLog(k, res, ok, secsPerIt, kEndEnd, nErrors);
         if (++nSeqErrors > 2) {
           log("%d sequential errors, will stop.\n", nSeqErrors);
@@ -1575,11 +2010,17 @@ PRPResult Gpu::isPrimePRP(const Task& task) {
         
       if (doStop) {
         queue->finish();
-        throw "stop requested";
+        throwStop(ctl);
       }
         
       iterationTimer.reset(k);
     }
+
+    if (ctl & Control::PAUSE) {
+      queue->finish();
+      Control::waitWhilePaused();
+      iterationTimer.reset(k);
+    }
   }
 }
 
@@ -1591,6 +2032,31 @@ LLResult Gpu::isPrimeLL(const Task& task) {
 
   Saver<LLState> saver{E, 1000, args.nSavefiles};
 
+  // The Jacobi check runs on the host in parallel with the squarings, one state at a time. Until the check passes
+  // the states are saved unverified, and a failed check rolls back to the last verified save.
+  const u32 JACOBI_STEP = 1'000'000;
+  bool useJacobi = hasJacobi();
+  if (!useJacobi) { log("LL: the Jacobi check is not available (built without GMP)\n"); }
+  LLState jacobiState;
+  std::future<std::pair<int, double>> jacobi;
+  int nSeqSumErrors = 0;
+
+  // Returns false if the check failed.
+  auto jacobiDone = [&]() {
+    HostOp op{"jacobiWait"};
+    auto [symbol, secs] = jacobi.get();
+    ++(symbol == -1 ? checksOK : checksFailed);
+    JsonLog::event("check", {{"kind", "LL"}, {"E", E}, {"k", jacobiState.k}, {"ok", symbol == -1}, {"checkSecs", secs}});
+    if (symbol == -1) {
+      log("Jacobi OK @ %u (%.1fs)\n", jacobiState.k, secs);
+      if (!jacobiState.data.empty()) { saver.save(jacobiState); }
+      return true;
+    }
+    log("Jacobi EE @ %u (%.1fs): %d, rolling back to the last verified savefile\n", jacobiState.k, secs, symbol);
+    saver.dropUnverified();
+    return false;
+  };
+
   reload:
   elapsedTimer.reset();
 
@@ -1619,12 +2085,13 @@ LLResult Gpu::isPrimeLL(const Task& task) {
     ++k;
     bool doStop = (k >= kEnd) || (args.iters && k - startK >= args.iters);
 
-    if (Signal::stopRequested()) {
+    u32 ctl = Control::pending();
+    if (Signal::stopRequested() || (ctl & (Control::STOP | Control::RELOAD))) {
       doStop = true;
       log("Stopping, please wait..\n");
     }
 
-    bool doLog = (k % 10'000 == 0) || doStop;
+    bool doLog = (k % 10'000 == 0) || doStop || (ctl & Control::SAVE);
     bool leadOut = doLog || useLongCarry;
 
     squareLL(bufData, leadIn, leadOut);
@@ -1640,7 +2107,7 @@ LLResult Gpu::isPrimeLL(const Task& task) {
       if (k < kEnd) {
         log("Error: early ZERO @ %u\n", k);
         if (doStop) {
-          throw "stop requested";
+          throwStop(ctl);
         } else {
           goto reload;
         }
@@ -1649,16 +2116,63 @@ LLResult Gpu::isPrimeLL(const Task& task) {
     } else {
       assert(data.size() >= 2);
       res64 = (u64(data[1]) << 32) | data[0];
-      saver.save({E, k, std::move(data), elapsedBefore + elapsedTimer.at()});
+    }
+
+    // A SUMINP/SUMOUT mismatch since the last log point: don't save this state, go back to the last save.
+    if (sumMismatch()) {
+      log("%9u SUMINP/SUMOUT mismatch, rolling back to the last savefile\n", k);
+      if (++nSeqSumErrors > 2) { throw "sequential errors"; }
+      if (doStop) { throwStop(ctl); }
+      goto reload;
+    }
+    nSeqSumErrors = 0;
+
+    // A verified save removes the unverified one, so the result of a check goes before the new unverified save.
+    if (jacobi.valid() && (doStop || jacobi.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+      if (!jacobiDone()) { goto reload; }
+    }
+
+    LLState state{E, k, std::move(data), elapsedBefore + elapsedTimer.at()};
+    if (!isAllZero) {
+      HostOp op{"save"};
+      if (useJacobi) {
+        saver.saveUnverified(state);
+      } else {
+        saver.save(state);
+      }
+    }
+
+    if (useJacobi && !jacobi.valid() && (k % JACOBI_STEP == 0 || k >= kEnd)) {
+      jacobiState = std::move(state);
+      jacobi = std::async(std::launch::async, [E = E, &jacobiState]() {
+        Timer timer;
+        int symbol = jacobiLL(E, jacobiState.data);
+        return std::pair{symbol, timer.at()};
+      });
     }
 
     float secsPerIt = iterationTimer.reset(k);
     queue->setSquareTime((int) (secsPerIt * 1'000'000));
     log("%9u %016" PRIx64 " %4.0f\n", k, res64, secsPerIt * 1'000'000);
+    JsonLog::event("progress", {{"kind", "LL"}, {"E", E}, {"k", k}, {"kEnd", kEnd}, {"usPerIt", secsPerIt * 1e6},
+                                {"res64", hex(res64)}});
+    updateCarryMode(readCarryStats());
+    publishMetrics("LL", k, kEnd, secsPerIt, saver.bytesWritten());
 
-    if (k >= kEnd) { return {isAllZero, res64}; }
+    if (k >= kEnd) {
+      // The final residue is checked before being reported.
+      if (jacobi.valid() && !jacobiDone()) { goto reload; }
+      return {isAllZero, res64};
+    }
 
-    if (doStop) { throw "stop requested"; }
+    if (ctl & Control::SAVE) { Control::done(Control::SAVE); }
+    if (doStop) { throwStop(ctl); }
+
+    if (ctl & Control::PAUSE) {
+      queue->finish();
+      Control::waitWhilePaused();
+      iterationTimer.reset(k);
+    }
   }
 }
 
@@ -1676,54 +2190,144 @@ array<u64, 4> Gpu::isCERT(const Task& task) {
   u32 nBytes = (E - 1) / 8 + 1;
   Words B = fi.readBytesLE(nBytes);
 
-  writeIn(bufData, std::move(B));
+  // The CERT chain is pure squaring, so it gets the Gerbicz check of PRP, with the start value in bufBase.
+  // The last verified state is kept on the host, and a failed check rolls back to it.
+  writeIn(bufBase, B);
+
+  const u32 blockSize = args.blockSize;
+  const u32 logStep = 100'000;
+  const u32 kEnd = task.squarings;
+  // We continue beyond kEnd, to the next multiple of blockSize, to do a check there
+  const u32 kEndEnd = roundUp(kEnd, blockSize);
+
+  u32 goodK = 0;
+  Words goodData = B;
+  Words goodCheck = std::move(B);
+  Words certWords;
+
+  u32 nErrors = 0;
+  int nSeqErrors = 0;
+  bool injected = false;
 
   Timer elapsedTimer;
 
-  elapsedTimer.reset();
+ reload:
+  u32 checkStep = args.adaptiveCheck ? adaptiveCheckStep(blockSize, logStep, errorHistory.rate(), nErrors)
+                                     : checkStepForErrors(blockSize, nErrors);
 
-  u32 startK = 0;
+  writeIn(bufData, goodData);
+  writeIn(bufCheck, goodCheck);
 
-  IterationTimer iterationTimer{startK};
+  u32 k = goodK;
+  u32 lastCheckK = k;
+  IterationTimer iterationTimer{k};
 
-  u32 k = 0;
-  u32 kEnd = task.squarings;
+  // The check buffer already includes the residue at goodK
+  bool skipNextCheckUpdate = true;
   bool leadIn = true;
 
   while (true) {
+    if (skipNextCheckUpdate) {
+      skipNextCheckUpdate = false;
+    } else if (k % blockSize == 0) {
+      assert(leadIn);
+      modMul(bufCheck, bufData);
+    }
+
     ++k;
-    bool doStop = (k >= kEnd);
+    bool doStop = false;
 
-    if (Signal::stopRequested()) {
+    u32 ctl = Control::pending();
+    if (Signal::stopRequested() || (ctl & (Control::STOP | Control::RELOAD))) {
       doStop = true;
       log("Stopping, please wait..\n");
     }
 
-    bool doLog = (k % 100'000 == 0) || doStop;
-    bool leadOut = doLog || useLongCarry;
+    bool doCheck = (k % checkStep == 0) || (k >= kEndEnd);
+    bool doLog = (k % logStep == 0) || (k == kEnd) || doStop;
+    bool leadOut = doLog || doCheck || (k % blockSize == 0) || useLongCarry;
 
     squareCERT(bufData, leadIn, leadOut);
     leadIn = leadOut;
 
-    if (!doLog) continue;
+    if (k == kEnd) { certWords = readData(); }
+
+    if (args.injectErrorK && leadOut && k >= args.injectErrorK && !injected) {
+      injected = true;
+      log("Injecting an error at %u\n", k);
+      injectError();
+    }
+
+    if (!doLog && !doCheck) continue;
 
-    Words data = readData();
-    assert(data.size() >= 2);
-    u64 res64 = (u64(data[1]) << 32) | data[0];
+    // A SUMINP/SUMOUT mismatch is a likely error: check now if at a block end, else the check comes soon anyway.
+    if (sumMismatch()) {
+      log("%9u SUMINP/SUMOUT mismatch%s\n", k, (!doCheck && k % blockSize == 0) ? ", checking early" : "");
+      doCheck = doCheck || k % blockSize == 0;
+    }
 
+    u64 res64 = dataResidue();
     float secsPerIt = iterationTimer.reset(k);
     queue->setSquareTime((int) (secsPerIt * 1'000'000));
-    log("%9u %016" PRIx64 " %4.0f\n", k, res64, secsPerIt * 1'000'000);
 
-    if (k >= kEnd) {
+    if (!doCheck) {
+      log("%9u %016" PRIx64 " %4.0f\n", k, res64, secsPerIt * 1'000'000);
+      JsonLog::event("progress", {{"kind", "CERT"}, {"E", E}, {"k", k}, {"kEnd", kEnd}, {"usPerIt", secsPerIt * 1e6},
+                                  {"res64", hex(res64)}});
+      publishMetrics("CERT", k, kEnd, secsPerIt, 0);
+      if (doStop) { throwStop(ctl); }
+      continue;
+    }
+
+    bool ok = this->doCheckCERT(blockSize);
+    float secsCheck = iterationTimer.reset(k);
+    if (args.adaptiveCheck) { errorHistory.add(k - lastCheckK, !ok); }
+    lastCheckK = k;
+
+    log("%9u %016" PRIx64 " %4.0f %s (check %.2fs) %u errors\n",
+        k, res64, secsPerIt * 1'000'000, ok ? "OK" : "EE", secsCheck, nErrors + !ok);
+    ++(ok ? checksOK : checksFailed);
+    JsonLog::event("check", {{"kind", "CERT"}, {"E", E}, {"k", k}, {"kEnd", kEnd}, {"usPerIt", secsPerIt * 1e6},
+                             {"res64", hex(res64)}, {"ok", ok}, {"errors", nErrors + !ok}, {"checkSecs", secsCheck}});
+    publishMetrics("CERT", k, kEnd, secsPerIt, 0);
+
+    if (!ok) {
+      ++nErrors;
+      if (++nSeqErrors > 2) {
+        log("%d sequential errors, will stop.\n", nSeqErrors);
+        throw "too many errors";
+      }
+      if (doStop) { throwStop(ctl); }
+      log("Rolling back to %u\n", goodK);
+      goto reload;
+    }
+
+    nSeqErrors = 0;
+    skipNextCheckUpdate = true;
+
+    if (k >= kEndEnd) {
+      assert(certWords.size() >= 2);
+      log("CERT done in %.0fs, %u errors\n", elapsedTimer.at(), nErrors);
       fs::remove (fname);
-      return std::move(SHA3{}.update(data.data(), (E-1)/8+1)).finish();
+      return std::move(SHA3{}.update(certWords.data(), (E-1)/8+1)).finish();
     }
 
-    if (doStop) { throw "stop requested"; }
+    if (doStop) { throwStop(ctl); }
+
+    goodK = k;
+    goodData = readData();
+    goodCheck = readCheck();
+    iterationTimer.reset(k);
   }
 }
 
+bool Gpu::doCheckCERT(u32 blockSize) {
+  squareLoop(bufAux, bufCheck, 0, blockSize, false);
+  modMul(bufAux, bufBase);
+  modMul(bufCheck, bufData);
+  return isEqual(bufCheck, bufAux);
+}
+
 
 void Gpu::clear(bool isPRP) {
   if (isPRP) {
@@ -4,6 +4,7 @@
 
 #include "Background.h"
 #include "Buffer.h"
+#include "HostBuffer.h"
 #include "Context.h"
 #include "Queue.h"
 #include "KernelCompiler.h"
@@ -14,9 +15,11 @@
 #include "Profile.h"
 #include "GpuCommon.h"
 #include "FFTConfig.h"
+#include "ErrorHistory.h"
 
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <filesystem>
 #include <cmath>
 
@@ -40,6 +43,28 @@ struct PRPResult {
   u32 nErrors = 0;
   fs::path proofPath{};
   std::string res2048;
+
+  // When non-zero the test is not finished: the ROE asks to continue from the savefile at iteration k with a
+  // larger (+1) or smaller (-1) FFT. z is the Z that triggered the switch.
+  int migrate{};
+  u32 k{};
+  double z{};
+};
+
+// Robust statistics of a set of timing sub-samples.
+struct TimeStats {
+  double median{};
+  double mad{};      // median absolute deviation, scaled to estimate the standard deviation
+  u32 n{};           // number of sub-samples
+  bool stable{};     // the spread is small relative to the median
+
+  static TimeStats of(vector<double> samples);
+
+  // Half-width of the ~95% confidence interval of the median; unknown (infinite) below MIN_SAMPLES sub-samples.
+  static constexpr u32 MIN_SAMPLES = 3;
+  double ci() const { return n >= MIN_SAMPLES ? 1.96 * 1.2533 * mad / std::sqrt(n) : INFINITY; }
+
+  operator double() const { return median; }
 };
 
 struct LLResult {
@@ -61,6 +86,12 @@ struct ZAvg {
 
 class RoeInfo {
 public:
+  // The histogram bins evenly cover [0, 0.5]; larger values fall in the last bin.
+  static constexpr u32 BINS = 32;
+
+  // From a record {count, max, sum, sum of squares, histogram[BINS]} produced by the roeStats kernel.
+  static RoeInfo fromRecord(const double* record);
+
   RoeInfo() = default;
   RoeInfo(u32 n, double max, double mean, double sd) : N{n}, max{max}, mean{mean}, sd{sd} {
     // https://en.wikipedia.org/wiki/Gumbel_distribution
@@ -70,14 +101,26 @@ public:
 
   double z(double x = 0.5) const { return N ? (x - gumbelMiu) / gumbelBeta : 0.0; }
 
+  // Half-width of the ~95% confidence interval of z(x), from the sampling variance of the moment estimates
+  // of the Gumbel parameters (delta method, with the Gumbel skewness and kurtosis).
+  double zCI(double x = 0.5) const;
+
+  // The statistics of the union of the two sets of samples.
+  static RoeInfo merge(const RoeInfo& a, const RoeInfo& b);
+
   double gumbelCDF(double x) const { return exp(-exp(-z(x))); }
   double gumbelRightCDF(double x) const { return -expm1(-exp(-z(x))); }
 
+  // The value below which a fraction p of the samples fall, interpolated within the histogram bins.
+  double quantile(double p) const;
+
   std::string toString() const;
+  std::string histogramString() const;
 
   u32 N{};
   double max{}, mean{}, sd{};
   double gumbelMiu{}, gumbelBeta{};
+  array<u32, BINS> hist{};
 };
 
 struct Weights {
@@ -107,6 +150,13 @@ private:
   u32 hN, nW, nH, bufSize;
   bool useLongCarry;
   u32 wantROE{};
+  u32 roeStride{1}; // Sample the ROE of one carry kernel in roeStride, to spread wantROE over the check step.
+  u32 roeTick{};
+
+  // Adaptive carry: near the CARRY32 limit, carryFused switches between CARRY32 and CARRY64 following the carry stats.
+  bool adaptiveCarry{};
+  bool useCarry64{};
+  u64 carry32Its{}, carry64Its{};
 
   Profile profile{};
 
@@ -118,6 +168,11 @@ private:
   Kernel kCarryFusedMulROE;
   Kernel kCarryFusedLL;
 
+  // The CARRY64 variants of the above, used by adaptive carry (when CARRY32 is the default).
+  Kernel kCarryFused64;
+  Kernel kCarryFusedROE64;
+  Kernel kCarryFusedLL64;
+
   Kernel kCarryA;
   Kernel kCarryAROE;
   Kernel kCarryM;
@@ -143,6 +198,7 @@ private:
   Kernel readResidue;
   Kernel kernIsEqual;
   Kernel sum64;
+  Kernel roeStats;
   Kernel testTrig;
   Kernel testFFT4;
   Kernel testFFT;
@@ -177,7 +233,7 @@ private:
   Buffer<int> bufData;   // Main int buffer with the words.
   Buffer<int> bufAux;    // Auxiliary int buffer, used in transposing data in/out and in check.
   Buffer<int> bufCheck;  // Buffers used with the error check.
-  Buffer<int> bufBase;   // used in P-1 error check.
+  Buffer<int> bufBase;   // The start value, used in the CERT error check.
 
   // Carry buffers, used in carry and fusedCarry.
   Buffer<i64> bufCarry;  // Carry shuttle.
@@ -191,9 +247,16 @@ private:
 
   Buffer<float> bufROE; // The round-off error ("ROE"), one float element per iteration.
   Buffer<float> bufStatsCarry;
+  Buffer<double> bufROEStats;  // Two records (squarings, multiplications) written by roeStats.
+  Buffer<u32> bufROEMulPos;    // The positions in bufROE that come from multiplications.
+  Buffer<double> bufSumCheck;  // The SUMINP/SUMOUT records written by carryFused, see carryutil.cl.
 
   u32 roePos{};   // The next position to write in the ROE stats buffer.
+  u32 roeReduced{}; // The positions before this were already read by roeSpike(), into roeSqPending and roeMulPending.
+  RoeInfo roeSqPending, roeMulPending; // ROE read by roeSpike() but not yet returned by readROE().
   u32 carryPos{}; // The next position to write in the Carry stats buffer.
+  u32 sumPos{};   // The carryFused iterations since the last SUMINP/SUMOUT read.
+  vector<u32> sumChained; // The positions of those that follow another carryFused, i.e. that can be checked.
 
   // The ROE positions originating from multiplications (as opposed to squarings).
   vector<u32> mulRoePos;
@@ -203,7 +266,16 @@ private:
   Buffer<double> buf2;
   Buffer<double> buf3;
 
+  // Pinned host memory for staging the residue transfers in readOut() and writeIn().
+  HostBuffer<int> hostStaging;
+
   unsigned statsBits;
+  ErrorHistory errorHistory;
+
+  // For the metrics file (-metrics): the checks of this test, the ROE of the last check and the proof bytes written.
+  u32 checksOK{}, checksFailed{};
+  RoeInfo lastRoe;
+  std::atomic<u64> proofBytes{};
   TimeInfo* timeBufVect;
   ZAvg zAvg;
 
@@ -239,7 +311,13 @@ private:
   void modMul(Buffer<int>& ioA, Buffer<int>& inB, bool mul3 = false);
   
   fs::path saveProof(const Args& args, const ProofSet& proofSet);
+  std::pair<RoeInfo, RoeInfo> reduceStats(Buffer<float>& buf, u32 from, u32 n, const vector<u32>& mulPos);
   std::pair<RoeInfo, RoeInfo> readROE();
+  bool roeSpike(double threshold);
+  bool sumMismatch();
+
+  void publishMetrics(const char* kind, u32 k, u32 kEnd, float secsPerIt, u64 savedBytes);
+  void injectError();
   RoeInfo readCarryStats();
   
   u32 updateCarryPos(u32 bit);
@@ -248,7 +326,7 @@ private:
 
   vector<int> readChecked(Buffer<int>& buf);
 
-  // void measureTransferSpeed();
+  void measureTransferSpeed();
 
   static void doDiv9(u32 E, Words& words);
   static bool equals9(const Words& words);
@@ -259,24 +337,38 @@ public:
   static unique_ptr<Gpu> make(Queue* q, u32 E, GpuCommon shared, FFTConfig fft,
                               const vector<KeyVal>& extraConf = {}, bool logFftSize = true);
 
+  // Predict the device memory that a Gpu for (E, fft) would allocate, without allocating anything.
+  // Includes the trig buffers (which may be shared with other workers) and the proof buffers.
+  static AllocTrac::Footprint estimateFootprint(const Args& args, cl_device_id id, FFTConfig fft, u32 E);
+
+  // What this Gpu allocated, by the same rules (the proof buffers are allocated later, during the PRP).
+  AllocTrac::Footprint footprint() const;
+
   ~Gpu();
 
-  PRPResult isPrimePRP(const Task& task);
+  // canGrow/canShrink allow returning early, at a verified checkpoint, to switch to a larger/smaller FFT.
+  PRPResult isPrimePRP(const Task& task, bool canGrow = false, bool canShrink = false);
   LLResult isPrimeLL(const Task& task);
   array<u64, 4> isCERT(const Task& task);
 
-  double timePRP();
+  // Times about *iters* PRP iterations; the result is per-iteration, in microseconds.
+  TimeStats timePRP(u32 iters = 1000);
 
-  tuple<bool, u64, RoeInfo, RoeInfo> measureROE(bool quick);
+  // With zTolerance, keep measuring until the confidence interval of the square Z is within it.
+  tuple<bool, u64, RoeInfo, RoeInfo> measureROE(bool quick, double zTolerance = 0);
   tuple<bool, RoeInfo> measureCarry();
 
   Saver<PRPState> *getSaver();
 
   void carryA(Buffer<double>& a, Buffer<double>& b) { carryA(reinterpret_cast<Buffer<int>&>(a), b); }
 
-  void carryA(Buffer<int>& a, Buffer<double>& b);
+  // Whether the next carry kernel is a ROE variant (see roeStride).
+  bool sampleROE();
 
-  void carryM(Buffer<int>& a, Buffer<double>& b);
+  // isMul: the carry of a multiplication, recorded as such in the ROE stats.
+  void carryA(Buffer<int>& a, Buffer<double>& b, bool isMul = false);
+
+  void carryM(Buffer<int>& a, Buffer<double>& b, bool isMul = false);
 
   void carryLL(Buffer<int>& a, Buffer<double>& b);
 
@@ -284,7 +376,8 @@ public:
 
   void carryFusedMul(Buffer<double>& a, Buffer<double>& b);
 
-  void carryFusedLL(Buffer<double>& a, Buffer<double>& b)  { kCarryFusedLL(a, b, updateCarryPos(1<<0));}
+  void carryFusedLL(Buffer<double>& a, Buffer<double>& b);
+  void updateCarryMode(const RoeInfo& carryStats);
 
   void writeIn(Buffer<int>& buf, const vector<u32> &words);
   
@@ -293,6 +386,9 @@ public:
     
   bool doCheck(u32 blockSize);
 
+  // The Gerbicz check of the CERT chain, with the start value in bufBase.
+  bool doCheckCERT(u32 blockSize);
+
   void logTimeKernels();
 
   Words readAndCompress(Buffer<int>& buf);
@@ -319,5 +415,5 @@ public:
 
 private:
   u32 getProofPower(u32 k);
-  void doBigLog(u32 k, u64 res, bool checkOK, float secsPerIt, u32 nIters, u32 nErrors);
+  RoeInfo doBigLog(u32 k, u64 res, bool checkOK, float secsPerIt, u32 nIters, u32 nErrors);
 };
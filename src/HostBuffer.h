@@ -0,0 +1,51 @@
+// Copyright (C) Mihai Preda.
+
+#pragma once
+
+#include "clwrap.h"
+#include "AllocTrac.h"
+#include "Queue.h"
+
+#include <memory>
+#include <cassert>
+
+/* A host-side staging buffer in pinned ("page-locked") memory, allocated by the driver with CL_MEM_ALLOC_HOST_PTR
+   and kept mapped for its whole lifetime. Transfers between a device Buffer and a HostBuffer can be DMA'd directly,
+   without the driver copying through its own bounce buffer as it does for ordinary (pageable) host memory.
+   It is counted against -maxAlloc (category "other"): on an integrated GPU it is device memory.
+*/
+template<typename T>
+class HostBuffer {
+  AllocTrac allocTrac;
+  std::unique_ptr<cl_mem> buf;
+  Queue* queue;
+  T* ptr;
+
+public:
+  const size_t size;
+
+  HostBuffer(Queue* queue, size_t size)
+    : allocTrac(size * sizeof(T), AllocTrac::OTHER)
+    , buf{makeBuf_(queue->context->get(), CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size * sizeof(T))}
+    , queue{queue}
+    , ptr{static_cast<T*>(queue->map(buf.get(), size * sizeof(T)))}
+    , size{size}
+  {
+    assert(size);
+  }
+
+  ~HostBuffer() { queue->unmap(buf.get(), ptr); }
+
+  HostBuffer(const HostBuffer&) = delete;
+  void operator=(const HostBuffer&) = delete;
+
+  void addTo(AllocTrac::Footprint& f) const { allocTrac.addTo(f); }
+
+  T* data() { return ptr; }
+  const T* data() const { return ptr; }
+
+  T* begin() { return ptr; }
+  T* end() { return ptr + size; }
+  const T* begin() const { return ptr; }
+  const T* end() const { return ptr + size; }
+};
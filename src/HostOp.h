@@ -0,0 +1,33 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+/* Labels what a worker thread is doing on the host, so that with -time the GPU idle gaps can be attributed to it:
+   a gap before a command is charged to the operation the host ran since it enqueued the previous command.
+   Only the outermost label counts (e.g. "readChecked" rather than the "readSync" inside it).
+*/
+class HostOp {
+  bool isOuter;
+
+  static inline thread_local const char* current{};
+  static inline thread_local const char* recent{};
+
+public:
+  explicit HostOp(const char* name) : isOuter{!current} {
+    if (isOuter) { current = recent = name; }
+  }
+
+  ~HostOp() {
+    if (isOuter) { current = nullptr; }
+  }
+
+  HostOp(const HostOp&) = delete;
+  HostOp& operator=(const HostOp&) = delete;
+
+  // The operation to charge the gap before the command being enqueued to; nullptr for unlabelled host work.
+  static const char* take() {
+    const char* ret = recent;
+    recent = current;
+    return ret;
+  }
+};
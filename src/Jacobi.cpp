@@ -0,0 +1,41 @@
+// Copyright (C) Mihai Preda
+
+#include "Jacobi.h"
+
+#include <cassert>
+
+#ifdef HAS_GMP
+
+#include <gmp.h>
+
+bool hasJacobi() { return true; }
+
+int jacobiLL(u32 E, const Words& words) {
+  mpz_t m, r;
+  mpz_init(m);
+  mpz_init(r);
+
+  // m = 2^E - 1
+  mpz_setbit(m, E);
+  mpz_sub_ui(m, m, 1);
+
+  if (!words.empty()) { mpz_import(r, words.size(), -1, sizeof(u32), 0, 0, words.data()); }
+  mpz_sub_ui(r, r, 2);
+  if (mpz_sgn(r) < 0) { mpz_add(r, r, m); }
+
+  int ret = mpz_jacobi(r, m);
+  mpz_clear(r);
+  mpz_clear(m);
+  return ret;
+}
+
+#else
+
+bool hasJacobi() { return false; }
+
+int jacobiLL(u32, const Words&) {
+  assert(false);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,16 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "common.h"
+
+/* The Jacobi check of the LL residue: for k >= 1 the LL term s(k) satisfies jacobi(s(k) - 2, 2^E - 1) == -1,
+   and a hardware error flips the symbol with probability 1/2. It is computed on the host with GMP, which is an
+   optional dependency; without it the check is not available.
+*/
+
+// Whether the build has the Jacobi check (i.e. was linked with GMP).
+bool hasJacobi();
+
+// jacobi(words - 2, 2^E - 1), where words is the LL residue mod 2^E - 1. An all-zero residue is passed as empty words.
+int jacobiLL(u32 E, const Words& words);
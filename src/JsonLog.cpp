@@ -0,0 +1,82 @@
+// Copyright (C) Mihai Preda
+
+#include "JsonLog.h"
+#include "Background.h"
+#include "File.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+std::atomic<bool> isEnabled{};
+File jsonFile;
+std::unique_ptr<Background> writer;
+
+thread_local u32 worker = 0;
+
+std::string quote(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (u8(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out + '"';
+}
+
+} // namespace
+
+JsonField::JsonField(const char* key, double value) : key{key} {
+  if (std::isfinite(value)) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.6g", value);
+    json = buf;
+  } else {
+    json = "null";
+  }
+}
+
+JsonField::JsonField(const char* key, const std::string& value) : key{key}, json{quote(value)} {}
+
+void JsonLog::init(const fs::path& path) {
+  jsonFile = File::openAppend(path);
+  // Large enough that a slow disk delays the writes instead of the worker threads.
+  writer = std::make_unique<Background>(4096);
+  isEnabled = true;
+}
+
+bool JsonLog::enabled() { return isEnabled; }
+
+void JsonLog::setWorker(u32 instance) { worker = instance; }
+
+void JsonLog::event(const char* type, std::initializer_list<JsonField> fields) {
+  if (!isEnabled) { return; }
+
+  double now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+  char buf[128];
+  snprintf(buf, sizeof(buf), "{\"time\":%.3f,\"worker\":%u,\"event\":", now, worker);
+  std::string line = buf + quote(type);
+  for (const JsonField& f : fields) {
+    line += ",\"";
+    line += f.key;
+    line += "\":";
+    line += f.json;
+  }
+  line += "}\n";
+
+  // Flushed per line: an event stuck in the stdio buffer is lost on a crash, when it matters most.
+  (*writer)([line = std::move(line)] {
+    jsonFile.write(line);
+    jsonFile.flush();
+  });
+}
@@ -0,0 +1,43 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "common.h"
+
+#include <concepts>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// A typed field of a JSON log event; the value is kept already encoded.
+struct JsonField {
+  template<typename T> requires std::integral<T> && (!std::same_as<T, bool>)
+  JsonField(const char* key, T value) : key{key}, json{std::to_string(value)} {}
+
+  JsonField(const char* key, double value);
+  JsonField(const char* key, bool value) : key{key}, json{value ? "true" : "false"} {}
+  JsonField(const char* key, const std::string& value);
+  JsonField(const char* key, const char* value) : JsonField(key, std::string{value}) {}
+
+  const char* key;
+  std::string json;
+};
+
+/* Opt-in (-jsonlog <file>) machine-readable log: one JSON object per line, appended from the same points that
+   print the progress, check and profile lines, e.g.
+   {"time":1760600000.123,"worker":0,"event":"check","kind":"PRP","E":136279841,"k":2000000,"ok":true,...}
+   Every event has "time" (Unix seconds), "worker" and "event"; res64 is a hex string. The lines are written by a
+   background thread, so the worker thread only formats them.
+*/
+class JsonLog {
+public:
+  static void init(const fs::path& path);
+  static bool enabled();
+
+  // The worker of the calling thread.
+  static void setWorker(u32 instance);
+
+  static void event(const char* type, std::initializer_list<JsonField> fields);
+};
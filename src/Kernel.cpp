@@ -5,6 +5,9 @@
 
 #include <stdexcept>
 
+std::atomic<u64> Kernel::nArgSet{};
+std::atomic<u64> Kernel::nArgSkip{};
+
 Kernel::Kernel(string_view name, KernelCompiler* compiler, TimeInfo* timeInfo, Queue* queue,
        string_view fileName, string_view nameInFile,
        size_t workSize, string_view defines):
@@ -38,6 +41,19 @@ void Kernel::finishLoad() {
   for (auto [pos, arg] : pendingArgs) { setArgs(pos, arg); }
 }
 
+void Kernel::setArg(u32 pos, const void* value, size_t size) {
+  assert(kernel);
+  if (pos >= argCache.size()) { argCache.resize(pos + 1); }
+  string_view bytes{static_cast<const char*>(value), size};
+  if (argCache[pos] == bytes) {
+    nArgSkip.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  CHECK2(clSetKernelArg(kernel.get(), pos, size, value), (name + '[' + to_string(pos) + "] size " + to_string(size)).c_str());
+  argCache[pos] = bytes;
+  nArgSet.fetch_add(1, std::memory_order_relaxed);
+}
+
 void Kernel::run() {
   assert(kernel);
   queue->run(kernel.get(), groupSize, workSize, timeInfo);
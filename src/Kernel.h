@@ -6,6 +6,7 @@
 #include "Buffer.h"
 #include "common.h"
 
+#include <atomic>
 #include <future>
 #include <string>
 #include <vector>
@@ -32,6 +33,15 @@ class Kernel {
   cl_device_id deviceId;
   std::vector<std::pair<u32, cl_mem>> pendingArgs;
 
+  // The bytes last bound to each argument position, used to skip redundant clSetKernelArg().
+  std::vector<std::string> argCache;
+
+  // Bitmask of the argument positions bound once with setFixedArgs().
+  u32 fixedArgs{};
+
+  static std::atomic<u64> nArgSet;
+  static std::atomic<u64> nArgSkip;
+
 public:
   Kernel(string_view name, KernelCompiler* compiler,
          TimeInfo* timeInfo, Queue* queue,
@@ -43,7 +53,10 @@ public:
   void startLoad(KernelCompiler* compiler);
   void finishLoad();
   
-  template<typename... Args> void setFixedArgs(int pos, const Args &...tail) { setArgs(pos, tail...); }
+  template<typename... Args> void setFixedArgs(int pos, const Args &...tail) {
+    fixedArgs |= ((1u << sizeof...(tail)) - 1) << pos;
+    setArgs(pos, tail...);
+  }
   
   template<typename... Args> void operator()(const Args &...args) {
     if (!kernel) {
@@ -51,10 +64,15 @@ public:
       finishLoad();
     }
     if (!kernel) { throw std::runtime_error("OpenCL kernel "s + name + " not found"); }
+    // The per-call args must not overlap the fixed args.
+    assert(!(fixedArgs & ((1u << sizeof...(args)) - 1)));
     setArgs(0, args...);
     run();
   }
 
+  // Counts of clSetKernelArg() calls done and skipped (because the value was unchanged), over all kernels.
+  static std::pair<u64, u64> argStats() { return {nArgSet, nArgSkip}; }
+
 private:
   template<typename T> void setArgs(int pos, const shared_ptr<Buffer<T>>& buf) { setArgs(pos, buf->get()); }
   template<typename T> void setArgs(int pos, const Buffer<T>* buf) { setArgs(pos, buf->get()); }
@@ -62,18 +80,21 @@ private:
 
   void setArgs(int pos, cl_mem arg) {
     if (kernel) {
-      ::setArg(kernel.get(), pos, arg, name);
+      setArg(pos, &arg, sizeof(arg));
     } else {
       pendingArgs.push_back({pos, arg});
     }
   }
 
-  template<typename T> void setArgs(int pos, const T &arg) { ::setArg(kernel.get(), pos, arg, name); }
+  template<typename T> void setArgs(int pos, const T &arg) { setArg(pos, &arg, sizeof(arg)); }
   
   template<typename T, typename... Args> void setArgs(int pos, const T &arg, const Args &...tail) {
     setArgs(pos, arg);
     setArgs(pos + 1, tail...);
   }
   
+  // Binds the argument only if it differs from the value last bound at that position.
+  void setArg(u32 pos, const void* value, size_t size);
+
   void run();
 };
@@ -0,0 +1,111 @@
+// Copyright (C) Mihai Preda
+
+#include "Metrics.h"
+#include "Background.h"
+#include "File.h"
+#include "log.h"
+
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+std::mutex metricsMutex;
+fs::path metricsPath;
+std::map<u32, WorkerMetrics> workers;
+bool isWriteQueued{}; // a write is queued that has not yet taken its snapshot of workers
+bool isFailing{};     // the last write failed (logged once per failure streak)
+
+// Declared after what its tasks use, thus destroyed (and joined) before.
+std::unique_ptr<Background> writer;
+
+thread_local u32 worker = 0;
+
+void write(const fs::path& path, const std::map<u32, WorkerMetrics>& snapshot) {
+  struct Gauge {
+    const char* name;
+    const char* help;
+    std::function<double(const WorkerMetrics&)> get;
+    const char* type = "gauge";
+  };
+
+  static const Gauge gauges[] = {
+    {"iteration",         "The current iteration",                        [](auto& m) { return m.k; }},
+    {"test_iterations",   "The iterations of the test",                   [](auto& m) { return m.kEnd; }},
+    {"us_per_iteration",  "Microseconds per iteration",                   [](auto& m) { return m.usPerIt; }},
+    {"eta_seconds",       "Estimated time to the end of the test",        [](auto& m) { return m.etaSecs; }},
+    {"checks_ok_total",   "The passed error checks of the test",          [](auto& m) { return m.checksOK; }, "counter"},
+    {"checks_failed_total", "The failed error checks of the test",        [](auto& m) { return m.checksFailed; }, "counter"},
+    {"roe_max",           "The max round-off error of the last interval", [](auto& m) { return m.roeMax; }},
+    {"roe_z",             "The round-off Z of the last interval",         [](auto& m) { return m.roeZ; }},
+    {"queue_stall_seconds", "Time blocked on the GPU queue",              [](auto& m) { return m.stallSecs; }},
+    {"bytes_written_total", "Bytes of savefiles and proof residues written", [](auto& m) { return double(m.bytesWritten); }, "counter"},
+  };
+
+  // The rename is what makes the update atomic for the reader; no sync, as it is rewritten at every log point.
+  fs::path tmp = path;
+  tmp += ".new";
+  {
+    File fo = File::openWriteNoSync(tmp);
+    for (const Gauge& g : gauges) {
+      fo.printf("# HELP prpll_%s %s\n# TYPE prpll_%s %s\n", g.name, g.help, g.name, g.type);
+      for (const auto& [w, m] : snapshot) {
+        fo.printf("prpll_%s{worker=\"%u\",kind=\"%s\",exponent=\"%u\"} %.10g\n",
+                  g.name, w, m.kind.c_str(), m.exponent, g.get(m));
+      }
+    }
+  }
+  fs::rename(tmp, path);
+}
+
+// On the writer thread. Takes the latest metrics, so the updates queued meanwhile are written at once.
+void writeLatest() {
+  fs::path path;
+  std::map<u32, WorkerMetrics> snapshot;
+  {
+    std::lock_guard lock{metricsMutex};
+    isWriteQueued = false;
+    path = metricsPath;
+    snapshot = workers;
+  }
+
+  // A broken monitoring file (full disk, missing directory) must not end the test.
+  try {
+    write(path, snapshot);
+    isFailing = false;
+  } catch (const std::exception& e) {
+    if (!isFailing) { log("Can't write metrics to '%s': %s\n", path.string().c_str(), e.what()); }
+    isFailing = true;
+  }
+}
+
+} // namespace
+
+void Metrics::init(fs::path path) {
+  std::lock_guard lock{metricsMutex};
+  metricsPath = path;
+  if (!writer) { writer = std::make_unique<Background>(); }
+}
+
+bool Metrics::enabled() {
+  std::lock_guard lock{metricsMutex};
+  return !metricsPath.empty();
+}
+
+void Metrics::setWorker(u32 instance) { worker = instance; }
+
+void Metrics::update(const std::function<void(WorkerMetrics&)>& f) {
+  std::lock_guard lock{metricsMutex};
+  f(workers[worker]);
+  // The file is written on the writer thread, so a slow disk does not stall the workers.
+  if (!metricsPath.empty() && !isWriteQueued) {
+    isWriteQueued = true;
+    (*writer)(writeLatest);
+  }
+}
+
+std::map<u32, WorkerMetrics> Metrics::snapshot() {
+  std::lock_guard lock{metricsMutex};
+  return workers;
+}
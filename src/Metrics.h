@@ -0,0 +1,48 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "common.h"
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// The metrics of one worker, as last published from its log points.
+struct WorkerMetrics {
+  std::string kind; // PRP, LL or CERT
+  u32 exponent{};
+  u32 k{};
+  u32 kEnd{};
+  double usPerIt{};
+  double etaSecs{};
+  u32 checksOK{};
+  u32 checksFailed{};
+  double roeMax{};
+  double roeZ{};
+  double stallSecs{};   // The time the worker thread spent blocked on the GPU queue.
+  u64 bytesWritten{};   // Savefiles and proof residues.
+};
+
+/* Opt-in (-metrics <file>) per-worker metrics, for monitoring a running instance. The file is in the Prometheus
+   text format (e.g. for the textfile collector of node_exporter), and is rewritten atomically after the updates,
+   by a background thread; a write error is logged and does not stop the workers.
+   The updates come from the existing log points, so publishing needs no GPU synchronisation of its own.
+*/
+class Metrics {
+public:
+  static void init(fs::path path);
+  static bool enabled();
+
+  // The worker of the calling thread.
+  static void setWorker(u32 instance);
+
+  // Updates the metrics of the calling thread's worker and queues the rewrite of the file, if any.
+  static void update(const std::function<void(WorkerMetrics&)>& f);
+
+  // The last published metrics of all the workers (also kept without a file, for the control socket).
+  static std::map<u32, WorkerMetrics> snapshot();
+};
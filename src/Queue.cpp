@@ -6,11 +6,64 @@
 #include "timeutil.h"
 #include "log.h"
 
+#include "HostOp.h"
+
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <thread>
 
-void Events::clearCompleted() { while (!empty() && front().isComplete()) { pop_front(); } }
+void Events::clearCompleted() {
+  while (!empty() && front().isComplete()) {
+    gaps.add(front());
+    pop_front();
+  }
+}
+
+void IdleGaps::record(const string& cause, u64 nanos) {
+  Stat& s = byCause[cause];
+  s.nanos += nanos;
+  ++s.n;
+  s.max = std::max(s.max, nanos);
+}
+
+void IdleGaps::add(const Event& e) {
+  auto [queued, submit, start, end] = e.timestamps;
+  if (!start || !end) { return; } // no profiling info
+
+  if (prevEnd && start > prevEnd) {
+    // Until the command was enqueued the GPU waited for the host; after that, for the launch.
+    u64 gap = start - prevEnd;
+    u64 host = queued > prevEnd ? std::min(queued - prevEnd, gap) : 0;
+    if (host) { record(e.hostOp ? e.hostOp : "host (unlabelled)", host); }
+    if (gap > host) { record("launch", gap - host); }
+  }
+  if (!spanStart) { spanStart = prevEnd ? prevEnd : start; }
+  prevEnd = std::max(prevEnd, end);
+}
+
+string IdleGaps::report() {
+  if (!spanStart || prevEnd <= spanStart) { return ""; }
+
+  vector<pair<string, Stat>> ranked{byCause.begin(), byCause.end()};
+  std::sort(ranked.begin(), ranked.end(), [](auto& a, auto& b) { return a.second.nanos > b.second.nanos; });
+  u64 span = prevEnd - spanStart;
+  u64 total = 0;
+  for (auto& [cause, s] : ranked) { total += s.nanos; }
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "GPU idle %.2f%% (%.1f ms of %.2f s):\n", 100.0 * total / span, total * 1e-6, span * 1e-9);
+  string out = buf;
+  for (auto& [cause, s] : ranked) {
+    snprintf(buf, sizeof(buf), "%s %5.2f%% %-18s %8.2f ms x%6u  max %.2f ms\n",
+             logContext().c_str(), 100.0 * s.nanos / span, cause.c_str(), s.nanos * 1e-6, s.n, s.max * 1e-6);
+    out += buf;
+  }
+
+  byCause.clear();
+  spanStart = 0;
+  return out;
+}
 
 void Events::synced() {
   clearCompleted();
@@ -32,7 +85,10 @@ Queue::Queue(const Context& context, bool profile) :
 }
 
 void Queue::writeTE(cl_mem buf, u64 size, const void* data, TimeInfo* tInfo) {
+  HostOp op{"write"};
+  Timer timer;
   add(::write(get(), {}, true, buf, size, data, hasEvents), tInfo);
+  stallSecs += timer.at();
   events.synced();
 }
 
@@ -52,14 +108,17 @@ void Queue::print() {
 }
 
 void Queue::add(EventHolder&& e, TimeInfo* ti) {
-  if (hasEvents) { events.emplace_back(std::move(e), ti); }
+  if (hasEvents) { events.emplace_back(std::move(e), ti, HostOp::take()); }
   queueCount++;
   if (queueCount == MAX_QUEUE_COUNT) queueMarkerEvent();
 }
 
 void Queue::readSync(cl_mem buf, u32 size, void* out, TimeInfo* tInfo) {
+  HostOp op{"readSync"};
   queueMarkerEvent();
+  Timer timer;
   add(read(get(), {}, true, buf, size, out, hasEvents), tInfo);
+  stallSecs += timer.at();
   events.synced();
 }
 
@@ -76,12 +135,28 @@ void Queue::run(cl_kernel kernel, size_t groupSize, size_t workSize, TimeInfo* t
 }
 
 void Queue::finish() {
+  HostOp op{"finish"};
   waitForMarkerEvent();
+  Timer timer;
   ::finish(get());
+  stallSecs += timer.at();
   events.synced();
   queueCount = 0;
 }
 
+EventHolder Queue::marker() {
+  EventHolder ret = ::marker(get());
+  ::flush(get());
+  return ret;
+}
+
+void Queue::wait(const EventHolder& marker) {
+  HostOp op{"markerWait"};
+  Timer timer;
+  waitForEvents({marker.get()});
+  stallSecs += timer.at();
+}
+
 void Queue::queueMarkerEvent() {
   waitForMarkerEvent();
   if (queueCount) {
@@ -100,6 +175,8 @@ void Queue::queueMarkerEvent() {
 
 void Queue::waitForMarkerEvent() {
   if (!markerQueued) return;
+  HostOp op{"markerWait"};
+  Timer timer;
   // By default, nVidia finish causes a CPU busy wait.  Instead, sleep for a while.  Since we know how many items are enqueued after the marker we can make an
   // educated guess of how long to sleep to keep CPU overhead low.
   while (getEventInfo(markerEvent) != CL_COMPLETE) {
@@ -107,6 +184,12 @@ void Queue::waitForMarkerEvent() {
     std::this_thread::sleep_for(std::chrono::microseconds(1 + queueCount * squareTime / 10));
   }
   markerQueued = false;
+  stallSecs += timer.at();
+}
+
+string Queue::idleReport() {
+  events.clearCompleted();
+  return events.gaps.report();
 }
 
 void Queue::setSquareTime(int time) {
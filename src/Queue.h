@@ -9,13 +9,39 @@
 #include "Event.h"
 
 #include <deque>
+#include <map>
+#include <string>
 #include <vector>
 
 class Args;
 class TimeInfo;
 
+// The GPU idle time between consecutive commands of a queue, from the profiling timestamps, by cause.
+class IdleGaps {
+  struct Stat {
+    u64 nanos{};
+    u32 n{};
+    u64 max{};
+  };
+
+  u64 prevEnd{};
+  u64 spanStart{};
+  std::map<std::string, Stat> byCause;
+
+  void record(const std::string& cause, u64 nanos);
+
+public:
+  // The completed commands, in queue order.
+  void add(const Event& e);
+
+  // The ranked causes since the previous report; empty if nothing was measured.
+  std::string report();
+};
+
 class Events : public std::deque<Event> {
 public:
+  IdleGaps gaps;
+
   void clearCompleted();
   void synced();
 };
@@ -41,6 +67,9 @@ public:
   template<typename T>
   void write(cl_mem buf, const vector<T>& v, TimeInfo* tInfo) { writeTE(buf, v.size() * sizeof(T), v.data(), tInfo); }
 
+  template<typename T>
+  void write(cl_mem buf, const T* data, size_t n, TimeInfo* tInfo) { writeTE(buf, n * sizeof(T), data, tInfo); }
+
   template<typename T>
   void fillBuf(cl_mem buf, T pattern, u32 size, TimeInfo* tInfo) { fillBufTE(buf, sizeof(T), &pattern, size, tInfo); }
 
@@ -50,14 +79,29 @@ public:
   void copyBuf(cl_mem src, cl_mem dst, u32 size, TimeInfo* tInfo);
   void finish();
 
+  // A marker after the commands enqueued so far, submitted to the device. Waiting for it, unlike finish(), keeps
+  // the commands enqueued after it running.
+  EventHolder marker();
+  void wait(const EventHolder& marker);
+
+  void* map(cl_mem buf, size_t size) { return mapBuf(get(), buf, size); }
+  void unmap(cl_mem buf, void* ptr) { unmapBuf(get(), buf, ptr); }
+
   void setSquareTime(int);          // Set the time to do one squaring (in microseconds)
 
+  // The total time the host spent blocked on this queue: syncing reads and writes, finish, and marker waits.
+  double stallTime() const { return stallSecs; }
+
+  // With profiling (-time): the GPU idle gaps since the previous report, ranked by the host operation causing them.
+  std::string idleReport();
+
 private:                            // This replaces the "call queue->finish every 400 squarings" code in Gpu.cpp.  Solves the busy wait on nVidia GPUs.
   int MAX_QUEUE_COUNT;              // Queue size before a marker will be enqueued.  Typically, 100 to 1000 squarings.
   cl_event markerEvent;             // Event associated with an enqueued marker placed in the queue every MAX_QUEUE_COUNT entries and before r/w operations.
   bool markerQueued;                // TRUE if a marker and event have been queued
   int queueCount;                   // Count of items added to the queue since last marker
   int squareTime;                   // Time to do one squaring (in microseconds)
+  double stallSecs{};               // See stallTime()
   void queueMarkerEvent();          // Queue the marker event
   void waitForMarkerEvent();        // Wait for marker event to complete
 };
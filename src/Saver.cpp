@@ -71,8 +71,15 @@ fs::path pathFor(fs::path base, const string& prefix, const string& kind, u32 k)
   return base / (prefix + str9(k) + '.' + kind);
 }
 
-fs::path pathUnverified(fs::path base, const string& prefix) {
-  return base / (prefix + "unverified.prp");
+// <prefix>unverified.<kind>: for PRP the same name as before there was an unverified LL save.
+fs::path pathUnverified(fs::path base, const string& prefix, const string& kind) {
+  return base / (prefix + "unverified." + kind);
+}
+
+u64 sizeOf(const fs::path& path) {
+  error_code ec;
+  u64 size = fs::file_size(path, ec);
+  return ec ? 0 : size;
 }
 
 // find the "most advanced" file in dir with a name of the form
@@ -204,7 +211,7 @@ void Saver<State>::moveToTrash(fs::path src) {
 
 template<typename State>
 fs::path Saver<State>::mostRecentSavefile() {
-  fs::path path = pathUnverified(base, prefix);
+  fs::path path = pathUnverified(base, prefix, State::KIND);
   error_code dummy;
   if (!fs::is_regular_file(path, dummy)) {
     path = findLast(base, prefix, State::KIND);
@@ -275,14 +282,22 @@ template<typename State>
 void Saver<State>::save(const State& state) {
   fs::path path = pathFor(base, to_string(exponent) + '-', State::KIND, state.k);
   ::writeState(*CycleFile{path}, state);
+  nBytes += sizeOf(path);
   trimFiles();
-  // log("rm '%s'\n", pathUnverified(base, prefix).string().c_str());
-  fs::remove(pathUnverified(base, prefix));
+  // log("rm '%s'\n", pathUnverified(base, prefix, State::KIND).string().c_str());
+  fs::remove(pathUnverified(base, prefix, State::KIND));
 }
 
-template<>
-void Saver<PRPState>::saveUnverified(const PRPState& state) const {
-  ::writeState(*CycleFile{pathUnverified(base, prefix)}, state);
+template<typename State>
+void Saver<State>::saveUnverified(const State& state) const {
+  ::writeState(*CycleFile{pathUnverified(base, prefix, State::KIND)}, state);
+  nBytes += sizeOf(pathUnverified(base, prefix, State::KIND));
+}
+
+template<typename State>
+void Saver<State>::dropUnverified() {
+  error_code dummy;
+  if (fs::is_regular_file(pathUnverified(base, prefix, State::KIND), dummy)) { moveToTrash(pathUnverified(base, prefix, State::KIND)); }
 }
 
 template<typename State>
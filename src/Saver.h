@@ -4,6 +4,7 @@
 
 #include "common.h"
 
+#include <atomic>
 #include <filesystem>
 #include <optional>
 
@@ -38,6 +39,7 @@ class Saver {
   fs::path base;
   string prefix;
   u32 nSavefiles;
+  mutable std::atomic<u64> nBytes{};
 
   State initState();
   void moveToTrash(fs::path file);
@@ -55,6 +57,11 @@ public:
 
   static void clear(u32 exponent);
 
-  // For PRP, we can save a verified save (see save() above) or an unverified save.
-  void saveUnverified(const PRPState& s) const;
+  // We can save a verified save (see save() above) or an unverified save: PRP verified by the Gerbicz check,
+  // LL by the Jacobi check. load() prefers the unverified save, dropUnverified() falls back to the last verified one.
+  void saveUnverified(const State& s) const;
+  void dropUnverified();
+
+  // The bytes of the savefiles written so far.
+  u64 bytesWritten() const { return nBytes; }
 };
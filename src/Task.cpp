@@ -95,6 +95,12 @@ string json(const vector<string>& v) {
 }
 
 string json(const string& s) { return '"' + s + '"'; }
+
+string jsonList(const vector<string>& v) {
+  string s;
+  for (const string& e : v) { s += (s.empty() ? "[" : ", ") + e; }
+  return s.empty() ? "[]" : s + ']';
+}
 string json(u32 x) { return to_string(x); }
 
 template<typename T> string json(const string& key, const T& value) { return json(key) + ':' + json(value); }
@@ -143,9 +149,80 @@ void writeResult(u32 instance, u32 E, const char *workType, const string &status
   File::append(resultsFile, s + '\n');
 }
 
+// Measure the ROE of the cheapest tuned FFTs near E, and take the first (i.e. the fastest) that is safe with a
+// margin: the lower end of its Z confidence interval must reach args.probeMinZ.
+FFTConfig probeFFT(GpuCommon shared, Queue* q, u32 E) {
+  const Args& args = *shared.args;
+  const double REACH = 1.03;
+  const u32 N_PROBE = 3;
+
+  FFTConfig fallback = FFTConfig::bestFit(args, E, {});
+  for (FFTConfig fft : FFTConfig::nearFits(args, E, REACH, N_PROBE)) {
+    if (fft.spec() == fallback.spec()) {
+      log("FFT probe: %s is within the BPW limits\n", fft.spec().c_str());
+      return fft;
+    }
+    auto [ok, res, roeSq, roeMul] = Gpu::make(q, E, shared, fft, {}, false)->measureROE(true, 1.0);
+    double z = roeSq.z();
+    double ci = roeSq.zCI();
+    bool isSafe = ok && z - ci >= args.probeMinZ;
+    log("FFT probe: %s Z=%.1f +- %.1f (%u iterations) %s\n",
+        fft.spec().c_str(), z, ci, roeSq.N, !ok ? "failed" : isSafe ? "accepted" : "rejected");
+    if (isSafe) { return fft; }
+  }
+  log("FFT probe: using %s\n", fallback.spec().c_str());
+  return fallback;
+}
+
+/* The FFT of a PRP test that switched FFT (-migrateLowZ), kept next to its savefiles so that a restart continues
+   on it. Lines:
+     fft <spec>
+     floor <maxExp>   : the largest FFT given up for a low Z; the test does not shrink back to it or below
+     switch <json>    : one per FFT switch, for the result line
+*/
+struct MigrateState {
+  std::optional<FFTConfig> fft;
+  u32 floor{};
+  vector<string> switches;
+
+  static fs::path path(u32 E) { return fs::current_path() / to_string(E) / "fft.txt"; }
+
+  static MigrateState load(u32 E) {
+    MigrateState ret;
+    File fi = File::openRead(path(E));
+    if (!fi) { return ret; }
+    for (const string& line : fi) {
+      auto sp = line.find(' ');
+      if (sp == string::npos) { continue; }
+      string key = line.substr(0, sp);
+      string value = rstripNewline(line.substr(sp + 1));
+      if (key == "fft") {
+        ret.fft = FFTConfig{value};
+      } else if (key == "floor") {
+        ret.floor = stoul(value);
+      } else if (key == "switch") {
+        ret.switches.push_back(value);
+      }
+    }
+    return ret;
+  }
+
+  void save(u32 E) const {
+    assert(fft);
+    fs::path tmp = path(E) += ".tmp";
+    {
+      File fo = File::openWrite(tmp);
+      fo.printf("fft %s\nfloor %u\n", fft->spec().c_str(), floor);
+      for (const string& s : switches) { fo.printf("switch %s\n", s.c_str()); }
+    }
+    fs::rename(tmp, path(E));
+  }
+};
+
 }
 
-void Task::writeResultPRP(const Args &args, u32 instance, bool isPrime, u64 res64, const string& res2048, u32 fftSize, u32 nErrors, const fs::path& proofPath) const {
+void Task::writeResultPRP(const Args &args, u32 instance, bool isPrime, u64 res64, const string& res2048, u32 fftSize, u32 nErrors, const fs::path& proofPath,
+                          const vector<string>& fftSwitches) const {
   vector<string> fields{json("res64", hex(res64)),
                         json("res2048", res2048),
                         json("residue-type", 1),
@@ -153,6 +230,8 @@ void Task::writeResultPRP(const Args &args, u32 instance, bool isPrime, u64 res6
                         json("fft-length", fftSize)
   };
 
+  if (!fftSwitches.empty()) { fields.push_back(json("fft-switches") + ':' + jsonList(fftSwitches)); }
+
   // "proof":{"version":1, "power":6, "hashsize":64, "md5":"0123456789ABCDEF"}, 
   if (!proofPath.empty()) {
     ProofInfo info = proof::getInfo(proofPath);
@@ -202,10 +281,26 @@ void Task::execute(GpuCommon shared, Queue *q, u32 instance) {
   assert(exponent);
 
   LogContext pushContext(std::to_string(exponent));
-
-  FFTConfig fft = FFTConfig::bestFit(*shared.args, exponent, shared.args->fftSpec);
+  // Declared before the Gpu: its allocation summary is logged once the Gpu is released, also on a throw.
+  AllocTrac::TaskScope allocScope;
+
+  bool canMigrate = kind == PRP && shared.args->migrateLowZ && shared.args->fftSpec.empty();
+  MigrateState migrated = canMigrate ? MigrateState::load(exponent) : MigrateState{};
+
+  FFTConfig fft = migrated.fft ? *migrated.fft
+    : (shared.args->probeMinZ && shared.args->fftSpec.empty() && kind != VERIFY)
+    ? probeFFT(shared, q, exponent)
+    : FFTConfig::bestFit(*shared.args, exponent, shared.args->fftSpec);
+  if (migrated.fft) { log("Continuing on %s after %u FFT switches\n", fft.spec().c_str(), u32(migrated.switches.size())); }
+
+  AllocTrac::Footprint footprint = Gpu::estimateFootprint(*shared.args, q->context->deviceId(), fft, exponent);
+  if (size_t need = AllocTrac::total(footprint); need > AllocTrac::availableBytes() || shared.args->verbose) {
+    log("%s predicted GPU alloc %.1f MB (available %.1f MB):%s\n", fft.spec().c_str(), need / (1024.0 * 1024),
+        AllocTrac::availableBytes() / (1024.0 * 1024), AllocTrac::format(footprint).c_str());
+  }
 
   auto gpu = Gpu::make(q, exponent, shared, fft);
+  log("%s\n", AllocTrac::summary().c_str());
 
   if (kind == VERIFY) {
     Proof proof{Proof::load(verifyPath)};
@@ -216,9 +311,34 @@ void Task::execute(GpuCommon shared, Queue *q, u32 instance) {
   } else if (kind == PRP || kind == LL) {
     bool isPrime;
     if (kind == PRP) {
-      auto [tmpIsPrime, res64, nErrors, proofPath, res2048] = gpu->isPrimePRP(*this);
-      isPrime = tmpIsPrime;
-      writeResultPRP(*shared.args, instance, isPrime, res64, res2048, fft.size(), nErrors, proofPath);
+      const Args& args = *shared.args;
+      vector<string>& fftSwitches = migrated.switches;
+      PRPResult r;
+      while (true) {
+        auto larger  = canMigrate ? FFTConfig::neighbour(args, exponent, fft, true)  : std::nullopt;
+        auto smaller = canMigrate ? FFTConfig::neighbour(args, exponent, fft, false) : std::nullopt;
+        // Never back to an FFT given up for a low Z: on the larger FFT the Z is usually high, and it would flip-flop.
+        if (smaller && smaller->maxExp() <= migrated.floor) { smaller.reset(); }
+        r = gpu->isPrimePRP(*this, larger.has_value(), smaller.has_value());
+        if (!r.migrate) { break; }
+
+        FFTConfig next = r.migrate > 0 ? *larger : *smaller;
+        log("FFT switch at %u: %s -> %s\n", r.k, fft.spec().c_str(), next.spec().c_str());
+        char z[32];
+        snprintf(z, sizeof(z), "%.1f", r.z);
+        fftSwitches.push_back(json(vector<string>{json("iteration", r.k),
+                                                  json("from", fft.spec()),
+                                                  json("to", next.spec()),
+                                                  json("z") + ':' + z}));
+        if (r.migrate > 0) { migrated.floor = std::max(migrated.floor, fft.maxExp()); }
+        migrated.fft = next;
+        migrated.save(exponent);
+        fft = next;
+        gpu.reset(); // release the buffers of the old FFT first
+        gpu = Gpu::make(q, exponent, shared, fft);
+      }
+      isPrime = r.isPrime;
+      writeResultPRP(args, instance, isPrime, r.res64, r.res2048, fft.size(), r.nErrors, r.proofPath, fftSwitches);
     } else { // LL
       auto [tmpIsPrime, res64] = gpu->isPrimeLL(*this);
       isPrime = tmpIsPrime;
@@ -287,7 +287,7 @@ TrigPtr TrigBufCache::smallTrig(u32 W, u32 nW) {
   TrigPtr p{};
   auto it = m.find(key);
   if (it == m.end() || !(p = it->second.lock())) {
-    p = make_shared<TrigBuf>(context, genSmallTrig(W, nW));
+    p = make_shared<TrigBuf>(context, "trig", genSmallTrig(W, nW));
     m[key] = p;
     smallCache.add(p);
   }
@@ -307,7 +307,7 @@ TrigPtr TrigBufCache::smallTrigCombo(u32 width, u32 middle, u32 W, u32 nW, u32 v
   TrigPtr p{};
   auto it = m.find(key1);
   if (it == m.end() || !(p = it->second.lock())) {
-    p = make_shared<TrigBuf>(context, genSmallTrigCombo(width, middle, W, nW, tail_single_wide, tail_trigs));
+    p = make_shared<TrigBuf>(context, "trig", genSmallTrigCombo(width, middle, W, nW, tail_single_wide, tail_trigs));
     m[key1] = p;
     m[key2] = p;
     smallCache.add(p);
@@ -323,7 +323,7 @@ TrigPtr TrigBufCache::middleTrig(u32 SMALL_H, u32 MIDDLE, u32 width) {
   TrigPtr p{};
   auto it = m.find(key);
   if (it == m.end() || !(p = it->second.lock())) {
-    p = make_shared<TrigBuf>(context, genMiddleTrig(SMALL_H, MIDDLE, width));
+    p = make_shared<TrigBuf>(context, "trig", genMiddleTrig(SMALL_H, MIDDLE, width));
     m[key] = p;
     middleCache.add(p);
   }
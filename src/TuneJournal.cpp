@@ -0,0 +1,72 @@
+// Copyright (C) Mihai Preda
+
+#include "TuneJournal.h"
+#include "FFTConfig.h"
+#include "File.h"
+#include "log.h"
+
+#include <algorithm>
+#include <sstream>
+
+TuneJournal::TuneJournal(fs::path path, std::string device, const string& build, bool fresh) : path{path}, device{device} {
+  std::replace(this->device.begin(), this->device.end(), ' ', '_');
+  if (this->device.empty()) { this->device = "-"; }
+  string deviceOnly = this->device + '#';
+  this->device += '#' + build;
+
+  File fi = fresh ? File{} : File::openRead(path);
+  if (!fi) { return; }
+
+  u32 nOtherBuild = 0;
+
+  for (const string& line : fi) {
+    auto sep = line.find(" : ");
+    if (sep == string::npos) {
+      log("%s: ignored line '%s'\n", path.string().c_str(), line.c_str());
+      continue;
+    }
+    string k = line.substr(0, sep);
+    if (k.substr(0, this->device.size() + 1) != this->device + ' ') {
+      if (k.substr(0, deviceOnly.size()) == deviceOnly) { ++nOtherBuild; }
+      continue;
+    }
+
+    std::istringstream in{line.substr(sep + 3)};
+    vector<double> values;
+    double x{};
+    while (in >> x) { values.push_back(x); }
+    entries[k] = values;
+  }
+
+  if (nOtherBuild) {
+    log("%s: not reusing %u measurements of another version or driver\n", path.string().c_str(), nOtherBuild);
+  }
+  if (!entries.empty()) {
+    log("Resuming tuning with %u measurements from %s\n", u32(entries.size()), path.string().c_str());
+  }
+}
+
+string TuneJournal::key(const string& kind, FFTConfig fft, u32 E, u32 iters, const string& config) const {
+  return device + ' ' + kind + ' ' + fft.spec() + ' ' + std::to_string(E) + ' ' + std::to_string(iters) + ' '
+      + (config.empty() ? "-" : config);
+}
+
+std::optional<vector<double>> TuneJournal::find(const string& kind, FFTConfig fft, u32 E, u32 iters,
+                                                const string& config) const {
+  auto it = entries.find(key(kind, fft, E, iters, config));
+  if (it == entries.end()) { return {}; }
+  return it->second;
+}
+
+void TuneJournal::add(const string& kind, FFTConfig fft, u32 E, u32 iters, const string& config,
+                      const vector<double>& values) {
+  string k = key(kind, fft, E, iters, config);
+  string line = k + " :";
+  char buf[32];
+  for (double x : values) {
+    snprintf(buf, sizeof(buf), " %.17g", x);
+    line += buf;
+  }
+  File::append(path, line + '\n');
+  entries[k] = values;
+}
@@ -0,0 +1,41 @@
+// Copyright (C) Mihai Preda
+
+#pragma once
+
+#include "common.h"
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class FFTConfig;
+
+/* An append-only record of the measurements done by -tune, -ctune, -ztune and -carryTune.
+   Every completed measurement is appended as one line:
+     <device>#<build> <kind> <FFT spec> <exponent> <iters> <config> : <values..>
+   where <build> identifies the program version, the driver and the OpenCL sources. When tuning is interrupted and
+   restarted, the measurements already in the journal for the same device and build are reused instead of being
+   re-run; those of other builds are kept (e.g. for tools/fitbpw.py) but not reused.
+   Delete the file, or use -tuneFresh, to start tuning from scratch.
+*/
+class TuneJournal {
+  fs::path path;
+  std::string device;
+  std::map<std::string, std::vector<double>> entries;
+
+  std::string key(const std::string& kind, FFTConfig fft, u32 E, u32 iters, const std::string& config) const;
+
+public:
+  // With fresh, nothing is read back from the file (it is still appended to).
+  TuneJournal(fs::path path, std::string device, const std::string& build, bool fresh = false);
+
+  std::optional<std::vector<double>> find(const std::string& kind, FFTConfig fft, u32 E, u32 iters,
+                                          const std::string& config) const;
+
+  void add(const std::string& kind, FFTConfig fft, u32 E, u32 iters, const std::string& config,
+           const std::vector<double>& values);
+};
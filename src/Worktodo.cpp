@@ -183,6 +183,23 @@ std::optional<Task> Worktodo::getTask(Args &args, i32 instance) {
   return getWork(args, instance);
 }
 
+std::vector<Task> Worktodo::pendingTasks(const Args &args) {
+  vector<Task> tasks;
+  if (args.prpExp) { tasks.push_back({Task::PRP, args.prpExp}); }
+  if (args.llExp) { tasks.push_back({Task::LL, args.llExp}); }
+
+  vector<fs::path> files;
+  for (u32 i = 0; i < args.workers; ++i) { files.push_back(workName(i)); }
+  if (!args.masterDir.empty()) { files.push_back(args.masterDir / "worktodo.txt"); }
+
+  for (const fs::path& name : files) {
+    for (const string& line : File::openRead(name)) {
+      if (optional<Task> task = parse(line)) { tasks.push_back(*task); }
+    }
+  }
+  return tasks;
+}
+
 bool Worktodo::deleteTask(const Task &task, i32 instance) {
   // Some tasks don't originate in worktodo.txt and thus don't need deleting.
   if (task.line.empty()) { return true; }
@@ -4,6 +4,7 @@
 
 #include "common.h"
 #include <optional>
+#include <vector>
 
 class Task;
 class Args;
@@ -12,4 +13,8 @@ class Worktodo {
 public:
   static std::optional<Task> getTask(Args &args, i32 instance);
   static bool deleteTask(const Task &task, i32 instance);
+
+  // All the PRP, LL and CERT tasks waiting in the local worktodo-<N> files of the workers, in the global worktodo
+  // of -pool, and given on the command line. Nothing is moved between the files.
+  static std::vector<Task> pendingTasks(const Args &args);
 };
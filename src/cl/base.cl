@@ -223,6 +223,19 @@ void OVERLOAD bar(void) {
 
 void OVERLOAD bar(u32 WG) { if (WG > WAVEFRONT) { bar(); } }
 
+// Sum over the workgroup (of power-of-two size); lds must hold one double per lane.
+double groupSum(local double* lds, double x) {
+  u32 me = get_local_id(0);
+  barrier(CLK_LOCAL_MEM_FENCE);
+  lds[me] = x;
+  for (u32 span = get_local_size(0) / 2; span; span /= 2) {
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (me < span) { lds[me] += lds[me + span]; }
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  return lds[0];
+}
+
 // A half-barrier is only needed when half-a-workgroup needs a barrier.
 // This is used e.g. by the double-wide tailSquare, where LDS is split between the halves.
 void halfBar() { if (get_enqueued_local_size(0) / 2 > WAVEFRONT) { bar(); } }
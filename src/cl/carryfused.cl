@@ -19,7 +19,8 @@ void spin() {
 // The "carryFused" is equivalent to the sequence: fftW, carryA, carryB, fftPremul.
 // It uses "stairway forwarding" (forwarding carry data from one workgroup to the next)
 KERNEL(G_W) carryFused(P(T2) out, CP(T2) in, u32 posROE, P(i64) carryShuttle, P(u32) ready, Trig smallTrig,
-		       CP(u32) bits, ConstBigTab CONST_THREAD_WEIGHTS, BigTab THREAD_WEIGHTS, P(uint) bufROE) {
+		       CP(u32) bits, ConstBigTab CONST_THREAD_WEIGHTS, BigTab THREAD_WEIGHTS, P(uint) bufROE,
+		       global double* sums) {
 
 #if 0   // fft_WIDTH uses shufl_int instead of shufl
   local T2 lds[WIDTH / 4];
@@ -62,6 +63,13 @@ KERNEL(G_W) carryFused(P(T2) out, CP(T2) in, u32 posROE, P(i64) carryShuttle, P(
   new_fft_WIDTH1(lds, u, smallTrig);
 #endif
 
+#if SUMCHECK
+  // Group H duplicates line zero, its output is counted by group 0. The words are the conjugate of u.
+  double sumOut = 0;
+  if (gr < H) { for (u32 i = 0; i < NW; ++i) { sumOut += u[i].x - u[i].y; } }
+  sumCheckPartial(sums, gr, 0, sumOut, (local double*) lds);
+#endif
+
   Word2 wu[NW];
 #if AMDGPU
   T2 weights = fancyMul(THREAD_WEIGHTS[me], THREAD_WEIGHTS[G_W + line]);
@@ -151,7 +159,13 @@ KERNEL(G_W) carryFused(P(T2) out, CP(T2) in, u32 posROE, P(i64) carryShuttle, P(
   }
 
   // Line zero will be redone when gr == H
-  if (gr == 0) { return; }
+  if (gr == 0) {
+#if SUMCHECK
+    if (me == 0) { sums[1 + 2 * SUMCHECK + 1] = 0; }
+    sumCheckDone(sums, H + 1, (local double*) lds);
+#endif
+    return;
+  }
 
   // Do some work while our carries may not be ready
 #if HAS_ASM
@@ -222,10 +236,20 @@ KERNEL(G_W) carryFused(P(T2) out, CP(T2) in, u32 posROE, P(i64) carryShuttle, P(
     u[i] *= U2(wu[i].x, wu[i].y);
   }
 
+#if SUMCHECK
+  double sumIn = 0;
+  for (u32 i = 0; i < NW; ++i) { sumIn += u[i].x + u[i].y; }
+  sumCheckPartial(sums, gr, 1, sumIn, (local double*) lds);
+#endif
+
   bar();
 
 //  fft_WIDTH(lds, u, smallTrig);
   new_fft_WIDTH2(lds, u, smallTrig);
 
   writeCarryFusedLine(u, out, line);
+
+#if SUMCHECK
+  sumCheckDone(sums, H + 1, (local double*) lds);
+#endif
 }
@@ -15,6 +15,54 @@ void updateStats(global uint *bufROE, u32 posROE, float roundMax) {
 }
 #endif
 
+#if SUMCHECK
+// The SUMINP/SUMOUT check: the sum of the (weighted) outputs of the inverse FFT is, up to the FFT scaling, the square
+// of the sum of the (weighted) inputs of the forward FFT. carryFused computes both sums per workgroup, and the last
+// workgroup to finish adds them up into one {sumOut, sumIn} record per iteration, for the host to check.
+// The layout of "sums" (SUMCHECK is the number of records):
+//   sums[0] : two u32 counters, the workgroups done in this iteration and the records written;
+//   sums[1 + 2 * i], sums[2 + 2 * i] : the record i, {sumOut, sumIn};
+//   sums[1 + 2 * SUMCHECK + 2 * g], ... + 1 : the per-workgroup partial sums.
+void sumCheckPartial(global double* sums, u32 gr, u32 slot, double x, local double* lds) {
+  x = groupSum(lds, x);
+  if (get_local_id(0) == 0) { sums[1 + 2 * SUMCHECK + 2 * gr + slot] = x; }
+}
+
+void sumCheckDone(global double* sums, u32 nGroups, local double* lds) {
+  u32 me = get_local_id(0);
+  global uint* counters = (global uint*) sums;
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+  if (me == 0) {
+    write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+    lds[0] = atomic_inc(counters) == nGroups - 1;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+  if (lds[0] == 0) { return; }
+
+  // The last workgroup: all the partial sums are written.
+  read_mem_fence(CLK_GLOBAL_MEM_FENCE);
+  volatile global double* partials = sums + 1 + 2 * SUMCHECK;
+  double sumOut = 0, sumIn = 0;
+  for (u32 g = me; g < nGroups; g += get_local_size(0)) {
+    sumOut += partials[2 * g];
+    sumIn  += partials[2 * g + 1];
+  }
+  sumOut = groupSum(lds, sumOut);
+  sumIn  = groupSum(lds, sumIn);
+
+  if (me == 0) {
+    counters[0] = 0;
+    u32 n = counters[1];
+    if (n < SUMCHECK) {
+      sums[1 + 2 * n] = sumOut;
+      sums[2 + 2 * n] = sumIn;
+    }
+    counters[1] = n + 1;
+  }
+}
+#endif
+
 #if defined(__has_builtin) && __has_builtin(__builtin_amdgcn_sbfe)
 i32 lowBits(i32 u, u32 bits) { return __builtin_amdgcn_sbfe(u, 0, bits); }
 #else
@@ -41,6 +41,61 @@ KERNEL(256) isEqual(global i64 *in1, global i64 *in2, P(int) outEqual) {
 }
 #endif
 
+#if ROESTATS
+// Reduces the n per-iteration maxima in "roe" to {count, max, sum, sum of squares, histogram[ROE_BINS]}, with the
+// histogram bins evenly covering [0, 0.5]. The positions listed (sorted) in mulPos are the multiplications and go
+// to a second record, after the squarings. The consumed "roe" entries are zeroed for the next round.
+KERNEL(256) roeStats(P(double) out, P(uint) roe, u32 from, u32 n, CP(u32) mulPos, u32 nMul) {
+  local u32 hist[2 * ROE_BINS];
+  local u32 count[2];
+  local u32 maxBits[2];
+  local double lds[256];
+
+  u32 me = get_local_id(0);
+  for (u32 i = me; i < 2 * ROE_BINS; i += 256) { hist[i] = 0; }
+  if (me < 2) {
+    count[me] = 0;
+    maxBits[me] = 0;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  double sum[2] = {0, 0};
+  double sum2[2] = {0, 0};
+  for (u32 i = from + me; i < n; i += 256) {
+    uint bits = roe[i];
+    roe[i] = 0;
+
+    u32 lo = 0;
+    u32 hi = nMul;
+    while (lo < hi) {
+      u32 mid = (lo + hi) / 2;
+      if (mulPos[mid] < i) { lo = mid + 1; } else { hi = mid; }
+    }
+    u32 k = (lo < nMul && mulPos[lo] == i) ? 1 : 0;
+
+    double x = as_float(bits);
+    sum[k] += x;
+    sum2[k] += x * x;
+    atomic_inc(&count[k]);
+    atomic_max(&maxBits[k], bits);
+    atomic_inc(&hist[k * ROE_BINS + min((u32) (x * (2 * ROE_BINS)), (u32) (ROE_BINS - 1))]);
+  }
+
+  for (u32 k = 0; k < 2; ++k) {
+    double s = groupSum(lds, sum[k]);
+    double s2 = groupSum(lds, sum2[k]);
+    global double* o = out + k * (4 + ROE_BINS);
+    if (me == 0) {
+      o[0] = count[k];
+      o[1] = as_float(maxBits[k]);
+      o[2] = s;
+      o[3] = s2;
+    }
+    for (u32 i = me; i < ROE_BINS; i += 256) { o[4 + i] = hist[k * ROE_BINS + i]; }
+  }
+}
+#endif
+
 #if TEST_KERNEL
 // Generate a small unused kernel so developers can look at how well individual macros assemble and optimize
 kernel void testKernel(global int* in, global double* out) {
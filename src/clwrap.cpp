@@ -80,6 +80,11 @@ string getBdfFromDevice(cl_device_id id) {
   return topology;
 }
 
+string getDeviceKey(cl_device_id id) {
+  string bdf = getBdfFromDevice(id);
+  return getDeviceName(id) + (bdf.empty() ? "" : "@" + bdf);
+}
+
 vector<cl_device_id> getAllDeviceIDs() {
   cl_platform_id platforms[16];
   int nPlatforms = 0;
@@ -363,6 +368,24 @@ void waitForEvents(vector<cl_event>&& waits) {
   }
 }
 
+EventHolder marker(cl_queue q) {
+  cl_event event{};
+  CHECK1(clEnqueueMarkerWithWaitList(q, 0, nullptr, &event));
+  return EventHolder{event};
+}
+
+void* mapBuf(cl_queue q, cl_mem buf, size_t size) {
+  int err = 0;
+  void* ptr = clEnqueueMapBuffer(q, buf, true, CL_MAP_READ | CL_MAP_WRITE, 0, size, 0, nullptr, nullptr, &err);
+  if (err == CL_OUT_OF_RESOURCES || err == CL_MEM_OBJECT_ALLOCATION_FAILURE) { throw bad_alloc{}; }
+  CHECK2(err, "clEnqueueMapBuffer");
+  return ptr;
+}
+
+void unmapBuf(cl_queue q, cl_mem buf, void* ptr) {
+  CHECK1(clEnqueueUnmapMemObject(q, buf, ptr, 0, nullptr, nullptr));
+}
+
 int getKernelNumArgs(cl_kernel k) {
   int nArgs = 0;
   CHECK1(clGetKernelInfo(k, CL_KERNEL_NUM_ARGS, sizeof(nArgs), &nArgs, NULL));
@@ -393,11 +416,9 @@ u32 getEventInfo(cl_event event) {
 static i64 delta(u64 a, u64 b) { return b - a; }
   // return b >= a ? i64(b - a) : -i64(a - b); }
 
-array<i64, 3> getEventNanos(cl_event event) {
-  u64 prev{};
-  array<i64, 3> ret{};
+array<u64, 4> getEventTimestamps(cl_event event) {
+  array<u64, 4> ret{};
 
-  // return {0,0,0};
   constexpr const u32 what[] = {
     CL_PROFILING_COMMAND_QUEUED,
     CL_PROFILING_COMMAND_SUBMIT,
@@ -406,14 +427,17 @@ array<i64, 3> getEventNanos(cl_event event) {
   };
 
   for (int i = 0; i < 4; ++i) {
-    u64 t{};
-    CHECK1(clGetEventProfilingInfo(event, what[i], sizeof(t), &t, 0));
-    if (i) { ret[i - 1] = delta(prev, t); }
-    prev = t;
+    CHECK1(clGetEventProfilingInfo(event, what[i], sizeof(ret[i]), &ret[i], 0));
   }
   return ret;
 }
 
+array<i64, 3> getEventNanos(const array<u64, 4>& t) {
+  array<i64, 3> ret{};
+  for (int i = 0; i < 3; ++i) { ret[i] = delta(t[i], t[i + 1]); }
+  return ret;
+}
+
 cl_context getQueueContext(cl_command_queue q) {
   cl_context ret;
   CHECK1(clGetCommandQueueInfo(q, CL_QUEUE_CONTEXT, sizeof(cl_context), &ret, 0));
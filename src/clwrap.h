@@ -67,6 +67,9 @@ string getDriverVersionByPos(int pos);
 
 string getBdfFromDevice(cl_device_id id);
 
+// Identifies a device across runs: its name, and its PCI location when known.
+string getDeviceKey(cl_device_id id);
+
 cl_context createContext(cl_device_id id);
 
 string getBuildLog(cl_program program, cl_device_id deviceId);
@@ -107,6 +110,13 @@ EventHolder fillBuf(cl_queue q, vector<cl_event>&& waits, cl_mem buf, const void
 
 void waitForEvents(vector<cl_event>&& waits);
 
+// An event that completes with all the commands enqueued before it.
+EventHolder marker(cl_queue q);
+
+// Blocking map of the whole buffer for host read & write.
+void* mapBuf(cl_queue q, cl_mem buf, size_t size);
+void unmapBuf(cl_queue q, cl_mem buf, void* ptr);
+
 
 int getKernelNumArgs(cl_kernel k);
 int getWorkGroupSize(cl_kernel k, cl_device_id device, const char *name);
@@ -114,8 +124,11 @@ std::string getKernelArgName(cl_kernel k, int pos);
 
 cl_device_id getDevice(u32 argsDevId);
 
+// Returns the 4 device timestamps: queued, submit, start, end
+std::array<u64, 4> getEventTimestamps(cl_event event);
+
 // Returns the 3 intervals: queued, submit, run
-std::array<i64, 3> getEventNanos(cl_event event);
+std::array<i64, 3> getEventNanos(const std::array<u64, 4>& timestamps);
 
 u32 getEventInfo(cl_event event);
 
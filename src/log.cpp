@@ -4,33 +4,269 @@
 #include "File.h"
 #include "timeutil.h"
 
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <memory>
 #include <mutex>
+#include <thread>
+
+/* log() does not block on the log files or on stdout: every thread formats its lines (with the timestamp taken at the
+   call site) into its own lock-free single-producer ring, and one logger thread drains the rings to the files.
+   When a ring is full (e.g. a blocked terminal or a slow disk), the line is dropped and the drop is counted; the
+   logger reports the count in the thread's log once it catches up. Per-thread order is kept.
+   On abort (a failed assert, std::terminate) a SIGABRT handler gives the logger up to a second to write out the
+   rings before the process dies; lines logged by the aborting thread after that are lost.
+*/
+
+namespace {
+
+class Ring {
+public:
+  static constexpr u32 SIZE = 256 * 1024; // power of two
+
+  std::atomic<bool> inUse{};   // owned by a thread, or not yet drained after its thread exited
+  std::atomic<bool> exited{};  // the owner thread exited
+  std::atomic<u64> head{};     // written by the owner
+  std::atomic<u64> tail{};     // written by the logger
+  std::atomic<u64> dropped{};
+  std::atomic<File*> newFile{}; // set by initLog(), taken over by the logger
+  File file;                    // the thread's log file; used by the logger only
+
+  // Called by the owner thread only.
+  bool push(string_view s) {
+    u32 len = s.size();
+    u64 h = head.load(std::memory_order_relaxed);
+    if (sizeof(len) + len > SIZE - (h - tail.load(std::memory_order_acquire))) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    copyIn(h, &len, sizeof(len));
+    copyIn(h + sizeof(len), s.data(), len);
+    head.store(h + sizeof(len) + len, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the logger only. Returns false if empty.
+  bool pop(string& out) {
+    u64 t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) { return false; }
+    u32 len{};
+    copyOut(t, &len, sizeof(len));
+    out.resize(len);
+    copyOut(t + sizeof(len), out.data(), len);
+    tail.store(t + sizeof(len) + len, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const { return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire); }
+
+private:
+  char buf[SIZE];
+
+  void copyIn(u64 pos, const void* data, u32 n) {
+    u32 p = pos % SIZE;
+    u32 first = std::min(n, SIZE - p);
+    memcpy(buf + p, data, first);
+    memcpy(buf, (const char*) data + first, n - first);
+  }
+
+  void copyOut(u64 pos, void* data, u32 n) const {
+    u32 p = pos % SIZE;
+    u32 first = std::min(n, SIZE - p);
+    memcpy(data, buf + p, first);
+    memcpy((char*) data + first, buf, n - first);
+  }
+};
+
+File stdoutFile{stdout, "stdout"};
+
+// Used when the logger thread is not running (after its shutdown).
+std::mutex syncMutex;
+
+class Logger {
+public:
+  static constexpr u32 MAX_RINGS = 256;
+
+  Logger() : thread{[this] { run(); }} {}
+
+  ~Logger() {
+    stopping = true;
+    wake();
+    thread.join();
+    stopped = true;
+  }
+
+  // The ring of the calling thread: a free (drained) ring is reused, else a new one is added.
+  // A free ring is already reset by the logger, so taking it is the CAS alone: the logger never sees an owned ring
+  // with a stale "exited".
+  Ring* acquire() {
+    u32 n = nRings.load(std::memory_order_acquire);
+    for (u32 i = 0; i < n; ++i) {
+      Ring* r = rings[i].load(std::memory_order_acquire);
+      bool expected = false;
+      if (r && r->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) { return r; }
+    }
+
+    // Claim the next slot, but never count past MAX_RINGS.
+    u32 pos = n;
+    do {
+      if (pos >= MAX_RINGS) { return nullptr; } // too many threads at once: fall back to writing synchronously
+    } while (!nRings.compare_exchange_weak(pos, pos + 1));
+    auto r = new Ring;
+    r->inUse = true;
+    rings[pos].store(r, std::memory_order_release);
+    return r;
+  }
+
+  void wake() {
+    pending.fetch_add(1, std::memory_order_release);
+    pending.notify_one();
+  }
+
+  std::atomic<bool> stopped{};
+
+  // Waits, for at most about a second, until the logger has written out all the rings. Used on the abort path.
+  void waitDrained() {
+    if (stopped || std::this_thread::get_id() == thread.get_id()) { return; } // no logger, or it is aborting
+    u32 pass0 = passes.load(std::memory_order_acquire);
+    for (int i = 0; i < 1000; ++i) {
+      wake();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      // A full pass after the rings were seen empty: the last lines are written and flushed.
+      if (allEmpty() && passes.load(std::memory_order_acquire) != pass0) { return; }
+    }
+  }
+
+private:
+  std::atomic<Ring*> rings[MAX_RINGS]{};
+  std::atomic<u32> nRings{};
+  std::atomic<u32> pending{};
+  std::atomic<u32> passes{}; // completed drain() passes
+  std::atomic<bool> stopping{};
+  std::jthread thread;
+
+  void write(Ring* r, string_view s) {
+    try {
+      if (r->file) { r->file.write(s); }
+      stdoutFile.write(s);
+    } catch (const WriteError&) {
+      // nowhere to report it
+    }
+  }
+
+  bool allEmpty() const {
+    u32 n = std::min(nRings.load(std::memory_order_acquire), MAX_RINGS);
+    for (u32 i = 0; i < n; ++i) {
+      Ring* r = rings[i].load(std::memory_order_acquire);
+      if (r && !r->empty()) { return false; }
+    }
+    return true;
+  }
+
+  // Returns true if anything was written.
+  bool drain() {
+    bool any = false;
+    string s;
+    u32 n = std::min(nRings.load(std::memory_order_acquire), MAX_RINGS);
+    for (u32 i = 0; i < n; ++i) {
+      Ring* r = rings[i].load(std::memory_order_acquire);
+      if (!r || !r->inUse) { continue; }
+
+      // Read "exited" first: once it is set the owner pushes no more.
+      bool exited = r->exited.load(std::memory_order_acquire);
+
+      if (File* f = r->newFile.exchange(nullptr)) {
+        r->file = std::move(*f);
+        delete f;
+      }
+
+      while (r->pop(s)) {
+        write(r, s);
+        any = true;
+      }
+
+      if (u64 nDropped = r->dropped.exchange(0)) {
+        write(r, shortTimeStr() + " log: dropped "s + std::to_string(nDropped) + " lines\n");
+      }
+
+      if (exited && r->empty()) {
+        // Reset before releasing: the next owner may take the ring as soon as inUse is false.
+        r->file = File{};
+        r->exited.store(false, std::memory_order_relaxed);
+        r->inUse.store(false, std::memory_order_release);
+      }
+    }
+    // stdout is not line buffered when redirected; the thread log files are.
+    if (any) { stdoutFile.flush(); }
+    passes.fetch_add(1, std::memory_order_release);
+    return any;
+  }
+
+  void run() {
+    while (true) {
+      u32 seen = pending.load(std::memory_order_acquire);
+      if (drain()) { continue; }
+      if (stopping) { break; }
+      pending.wait(seen, std::memory_order_acquire);
+    }
+    drain();
+  }
+};
+
+Logger logger;
+
+void onAbort(int sig) {
+  logger.waitDrained();
+  std::signal(sig, SIG_DFL);
+  std::raise(sig);
+}
+
+[[maybe_unused]] const auto abortHandler = std::signal(SIGABRT, onAbort);
+
+// Marks the thread's ring for release at thread exit.
+struct RingOwner {
+  Ring* ring = logger.acquire();
+
+  ~RingOwner() {
+    if (ring) {
+      ring->exited.store(true, std::memory_order_release);
+      logger.wake();
+    }
+  }
+};
+
+thread_local RingOwner owner;
 
 thread_local string context;
 thread_local vector<string> contextParts;
 
-thread_local File logFile;
+thread_local char logBuf[32 * 1024];
 
-File stdoutFile{stdout, "stdout"};
+// The thread's log file when the thread has no ring.
+thread_local File syncLogFile;
+
+} // namespace
 
 string logContext() { return context; }
 
 void initLog(const char *logName) {
-  assert(!logFile);
-  logFile = File::openAppend(logName);
+  File f = File::openAppend(logName);
+  if (Ring* r = owner.ring; r && !logger.stopped) {
+    delete r->newFile.exchange(new File{std::move(f)});
+    logger.wake();
+  } else {
+    syncLogFile = std::move(f);
+  }
 }
 
 string longTimeStr()  { return timeStr("%Y-%m-%d %H:%M:%S %Z"); }
 string shortTimeStr() { return timeStr("%Y%m%d %H:%M:%S"); }
 
-static char logBuf[32 * 1024];
-
 void log(const char *fmt, ...) {
-  static std::mutex logMutex;
-
   string prefix = shortTimeStr() + ' ' + context;
 
-  std::unique_lock lock(logMutex);
   int pos = 0;
   snprintf(logBuf, sizeof(logBuf), "%s %n", prefix.c_str(), &pos);
 
@@ -40,8 +276,13 @@ void log(const char *fmt, ...) {
   va_end(va);
   string_view s{logBuf};
 
-  if (logFile) { logFile.write(s); }
-  stdoutFile.write(s);
+  if (Ring* r = owner.ring; r && !logger.stopped) {
+    if (r->push(s)) { logger.wake(); }
+  } else {
+    std::unique_lock lock(syncMutex);
+    if (syncLogFile) { syncLogFile.write(s); }
+    stdoutFile.write(s);
+  }
 }
 
 LogContext::LogContext(const string& s) : part{s} {
@@ -8,6 +8,7 @@
 #include "Worktodo.h"
 #include "version.h"
 #include "AllocTrac.h"
+#include "FFTConfig.h"
 #include "typeName.h"
 #include "log.h"
 #include "Context.h"
@@ -15,6 +16,9 @@
 #include "GpuCommon.h"
 #include "Gpu.h"
 #include "tune.h"
+#include "Metrics.h"
+#include "JsonLog.h"
+#include "Control.h"
 
 #include <filesystem>
 #include <thread>
@@ -23,6 +27,9 @@
 namespace fs = std::filesystem;
 
 void gpuWorker(GpuCommon shared, Queue *q, i32 instance) {
+  Metrics::setWorker(instance);
+  JsonLog::setWorker(instance);
+  Control::setWorker(instance);
   // LogContext context{(instance ? shared.args->tailDir() : ""s) + to_string(instance) + ' '};
   // log("Starting worker %d\n", instance);
   if (instance > 0) {
@@ -31,7 +38,15 @@ void gpuWorker(GpuCommon shared, Queue *q, i32 instance) {
   }
 
   try {
-    while (auto task = Worktodo::getTask(*shared.args, instance)) { task->execute(shared, q, instance); }
+    while (auto task = Worktodo::getTask(*shared.args, instance)) {
+      try {
+        task->execute(shared, q, instance);
+      } catch (const ReloadRequest&) {
+        // The savefile of the interrupted test must be written before the test can be picked again.
+        shared.background->waitEmpty();
+        log("Reloading worktodo\n");
+      }
+    }
   } catch (const char *mes) {
     log("Exception \"%s\"\n", mes);
   } catch (const string& mes) {
@@ -84,12 +99,33 @@ int main(int argc, char **argv) {
     args.readConfig("config.txt");
     args.parse(mainLine);
     args.setDefaults();
+
+    if (fs::path bpwFile = args.bpwFile.empty() ? "fftbpw.txt" : args.bpwFile; fs::exists(bpwFile) || !args.bpwFile.empty()) {
+      u32 n = FFTShape::loadBpw(bpwFile);
+      log("Loaded %u FFT BPW limits from '%s'\n", n, bpwFile.string().c_str());
+    }
         
     if (args.maxAlloc) { AllocTrac::setMaxAlloc(args.maxAlloc); }
 
+    if (!args.metricsFile.empty()) {
+      Metrics::init(args.metricsFile);
+      log("Writing metrics to '%s'\n", args.metricsFile.string().c_str());
+    }
+
+    if (!args.jsonLogFile.empty()) {
+      JsonLog::init(args.jsonLogFile);
+      log("Writing the JSON log to '%s'\n", args.jsonLogFile.string().c_str());
+    }
+
     Context context(getDevice(args.device));
     TrigBufCache bufCache{&context};
     Signal signal;
+
+    if (!args.controlSocket.empty()) {
+      Control::start(args.controlSocket, args.workers);
+      log("Listening for control commands on '%s'\n", args.controlSocket.string().c_str());
+    }
+
     Background background;
     GpuCommon shared{&args, &bufCache, &background};
 
@@ -125,6 +161,7 @@ int main(int argc, char **argv) {
     log("Exiting because \"%s\"\n", mes.c_str());
   }
 
+  Control::shutdown();
   log("Bye\n");
   return exitCode; // not used yet.
 }
@@ -29,6 +29,7 @@ typedef unsigned cl_event_info;
 typedef unsigned cl_command_queue_info;
 
 typedef u64 cl_mem_flags;
+typedef u64 cl_map_flags;
 typedef u64 cl_svm_mem_flags;
 typedef u64 cl_device_type;
 typedef u64 cl_queue_properties;
@@ -81,6 +82,10 @@ int clEnqueueCopyBuffer(cl_command_queue, cl_mem, cl_mem, size_t, size_t, size_t
                         unsigned numEvent, const cl_event *waitEvents, cl_event *outEvent);
 int clEnqueueFillBuffer(cl_command_queue, cl_mem, const void *, size_t patternSize, size_t offset, size_t size,
                         unsigned numEvent, const cl_event *waitEvents, cl_event *outEvent);
+void* clEnqueueMapBuffer(cl_command_queue, cl_mem, cl_bool, cl_map_flags, size_t offset, size_t size,
+                         unsigned numEvent, const cl_event *waitEvents, cl_event *outEvent, int *err);
+int clEnqueueUnmapMemObject(cl_command_queue, cl_mem, void *,
+                            unsigned numEvent, const cl_event *waitEvents, cl_event *outEvent);
   
 int clFlush(cl_command_queue);
 int clFinish(cl_command_queue);
@@ -133,6 +138,9 @@ int clSetKernelArgSVMPointer(cl_kernel, unsigned, const void *);
 #define CL_MEM_HOST_READ_ONLY   (1 << 8)
 #define CL_MEM_HOST_NO_ACCESS   (1 << 9)
 
+#define CL_MAP_READ             (1 << 0)
+#define CL_MAP_WRITE            (1 << 1)
+
 #define CL_MEM_SVM_FINE_GRAIN_BUFFER (1 << 10)
 #define CL_MEM_SVM_ATOMICS           (1 << 11)
 
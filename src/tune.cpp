@@ -9,8 +9,21 @@
 #include "log.h"
 #include "File.h"
 #include "TuneEntry.h"
-
+#include "CostModel.h"
+#include "Task.h"
+#include "Worktodo.h"
+#include "Queue.h"
+#include "clwrap.h"
+#include "timeutil.h"
+#include "version.h"
+#include "Sha3Hash.h"
+
+#include <algorithm>
+#include <cmath>
 #include <numeric>
+#include <set>
+#include <thread>
+#include <exception>
 #include <string>
 #include <vector>
 #include <cassert>
@@ -19,6 +32,9 @@ using std::accumulate;
 
 using namespace std;
 
+// Implemented in bundle.cpp
+const std::vector<const char*>& getClFiles();
+
 vector<string> split(const string& s, char delim) {
   vector<string> ret;
   size_t start = 0;
@@ -37,6 +53,17 @@ vector<string> split(const string& s, char delim) {
 
 namespace {
 
+// The program version, the driver and the OpenCL sources: a change of any of them may change the measurements.
+string buildKey(cl_device_id id) {
+  SHA3 hasher;
+  hasher.update(string(VERSION));
+  hasher.update(getDriverVersion(id));
+  for (const char* src : getClFiles()) { hasher.update(string(src)); }
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%08x", u32(std::move(hasher).finish()[0]));
+  return buf;
+}
+
 vector<TuneConfig> permute(const vector<pair<string, vector<string>>>& params) {
   vector<TuneConfig> configs;
 
@@ -171,17 +198,68 @@ printf ("Reguess bpw for %s is %.2f first Z22 is %.2f\n", fft.spec().c_str(), bp
   return bpw2 + (bpw1 - bpw2) * (TARGET - z2) / (z1 - z2);
 }
 
+// Measure Z at *count* exponents around bpw, each on its own queue in parallel.
+// Each measurement runs until the confidence interval of its Z is within ZTUNE_CI (or a maximum iteration count).
 double Tune::zForBpw(double bpw, FFTConfig fft, u32 count) {
+  const double ZTUNE_CI = 0.5;
+
+  vector<u32> exponents;
   u32 exponent = (count == 1) ? primes.prevPrime(fft.size() * bpw) : primes.nextPrime(fft.size() * bpw);
+  for (u32 i = 0; i < count; i++, exponent = primes.nextPrime (exponent + 1)) { exponents.push_back(exponent); }
+
+  string config = configKey({});
+  vector<double> zs(count), cis(count);
+  vector<bool> oks(count);
+  vector<u32> pending;
+
+  for (u32 i = 0; i < count; ++i) {
+    if (auto v = journal.find("roe", fft, exponents[i], 0, config); v && v->size() >= 2) {
+      zs[i] = (*v)[0];
+      oks[i] = (*v)[1] != 0;
+      cis[i] = v->size() >= 3 ? (*v)[2] : 0;
+    } else {
+      pending.push_back(i);
+    }
+  }
+
+  if (!pending.empty()) {
+    // The first measurement uses the tune queue, the others get their own queue on the same context.
+    vector<Queue> queues;
+    for (u32 i = 1; i < pending.size(); ++i) { queues.emplace_back(*q->context, shared.args->profile); }
+
+    vector<std::exception_ptr> errors(pending.size());
+    {
+      vector<jthread> threads;
+      for (u32 j = 0; j < pending.size(); ++j) {
+        Queue* queue = j ? &queues[j - 1] : q;
+        threads.emplace_back([&, j, queue]() {
+          u32 i = pending[j];
+          try {
+            LogContext context{to_string(exponents[i])};
+            auto [ok, res, roeSq, roeMul] = Gpu::make(queue, exponents[i], shared, fft, {}, false)->measureROE(true, ZTUNE_CI);
+            oks[i] = ok;
+            zs[i] = roeSq.z();
+            cis[i] = roeSq.zCI();
+          } catch (...) {
+            errors[j] = std::current_exception();
+          }
+        });
+      }
+    }
+    for (auto& e : errors) { if (e) { std::rethrow_exception(e); } }
+
+    for (u32 i : pending) { journal.add("roe", fft, exponents[i], 0, config, {zs[i], double(oks[i]), cis[i]}); }
+  }
+
   double total_z = 0.0;
-  for (u32 i = 0; i < count; i++, exponent = primes.nextPrime (exponent + 1)) {
-    auto [ok, res, roeSq, roeMul] = Gpu::make(q, exponent, shared, fft, {}, false)->measureROE(true);
-    double z = roeSq.z();
-    total_z += z;
-log("Zforbpw %.2f (z %.2f) : %s\n", bpw, z, fft.spec().c_str());
-    if (!ok) { log("Error at bpw %.2f (z %.2f) : %s\n", bpw, z, fft.spec().c_str()); continue; }
+  double var = 0;
+  for (u32 i = 0; i < count; ++i) {
+    total_z += zs[i];
+    var += cis[i] * cis[i];
+log("Zforbpw %.2f (z %.2f +- %.2f) : %s\n", bpw, zs[i], cis[i], fft.spec().c_str());
+    if (!oks[i]) { log("Error at bpw %.2f (z %.2f) : %s\n", bpw, zs[i], fft.spec().c_str()); }
   }
-//printf ("Out zForBpw %s %.2f avg %.2f\n", fft.spec().c_str(), bpw, total_z / count);
+  if (count > 1) { log("Zforbpw %.2f avg z %.2f +- %.2f : %s\n", bpw, total_z / count, sqrt(var) / count, fft.spec().c_str()); }
   return total_z / count;
 }
 
@@ -249,10 +327,22 @@ void Tune::carryTune() {
     const double mid = fft.shape.carry32BPW();
     for (double bpw : {mid - 0.05, mid + 0.05}) {
       u32 exponent = primes.nearestPrime(fft.size() * bpw);
-      auto [ok, carry] = Gpu::make(q, exponent, shared, fft, {}, false)->measureCarry();
-      m = carry.max;
+      string config = configKey({});
+      bool ok{};
+      double z{};
+      if (auto v = journal.find("carry", fft, exponent, 0, config); v && v->size() == 3) {
+        z = (*v)[0];
+        m = (*v)[1];
+        ok = (*v)[2] != 0;
+      } else {
+        auto [tmpOk, carry] = Gpu::make(q, exponent, shared, fft, {}, false)->measureCarry();
+        ok = tmpOk;
+        z = carry.z();
+        m = carry.max;
+        journal.add("carry", fft, exponent, 0, config, {z, m, double(ok)});
+      }
       if (!ok) { log("Error %s at %f\n", fft.spec().c_str(), bpw); }
-      zv.push_back(carry.z());
+      zv.push_back(z);
     }
 
     double avg = (zv[0] + zv[1]) / 2;
@@ -308,7 +398,7 @@ void Tune::ctune() {
         for (u32 k = i + 1; k < configsVect.size(); ++k) {
           add(c, configsVect[k][bestPos[k]]);
         }
-        auto cost = Gpu::make(q, exponent, shared, fft, c, false)->timePRP();
+        double cost = timeConfig(fft, exponent, FULL_ITERS, c);
 
         bool isBest = (cost < best.cost);
         if (isBest) {
@@ -325,9 +415,298 @@ void Tune::ctune() {
   log("\nBest configs (lines can be copied to config.txt):\n%s", formatConfigResults(results).c_str());
 }
 
+Tune::Tune(Queue *q, GpuCommon shared) :
+  q{q},
+  shared{shared},
+  journal{"tune-journal.txt", getDeviceKey(q->context->deviceId()), buildKey(q->context->deviceId()), shared.args->tuneFresh}
+{}
+
+// The -use config in effect for a measurement, with *extra* taking priority as in Gpu.
+string Tune::configKey(const TuneConfig& extra) const {
+  map<string, string> config{extra.begin(), extra.end()};
+  config.insert(shared.args->flags.begin(), shared.args->flags.end());
+  string s;
+  for (const auto& [k, v] : config) { s += k + '=' + v + ','; }
+  if (!s.empty()) { s.pop_back(); }
+  return s;
+}
+
+TimeStats Tune::timeConfig(FFTConfig fft, u32 exponent, u32 iters, const TuneConfig& extra, const string& kind) {
+  string config = configKey(extra);
+  if (auto v = journal.find(kind, fft, exponent, iters, config); v && v->size() == 4) {
+    return {(*v)[0], (*v)[1], u32((*v)[2]), (*v)[3] != 0};
+  }
+
+  TimeStats t = Gpu::make(q, exponent, shared, fft, extra, false)->timePRP(iters);
+  if (!t.stable) { log("Unstable timing %12s: %.1f +- %.1f us\n", fft.spec().c_str(), t.median, t.mad); }
+  journal.add(kind, fft, exponent, iters, config, {t.median, t.mad, double(t.n), double(t.stable)});
+  return t;
+}
+
+// Time a few candidates spread over the FFT sizes, fit the cost model to them, and drop the candidates that the model
+// predicts to be clearly slower than another candidate handling at least the same exponent.
+vector<TuneCandidate> Tune::prune(const vector<TuneCandidate>& candidates) {
+  const u32 N_CALIBRATION = 10;
+  if (candidates.size() <= 2 * N_CALIBRATION) { return candidates; }
+
+  vector<u32> order(candidates.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) { return candidates[a].fft.size() < candidates[b].fft.size(); });
+
+  vector<bool> isCalibration(candidates.size());
+  vector<CostModel::Sample> samples;
+  for (u32 k = 0; k < N_CALIBRATION; ++k) {
+    u32 i = order[k * (order.size() - 1) / (N_CALIBRATION - 1)];
+    isCalibration[i] = true;
+    auto [fft, exponent] = candidates[i];
+    samples.push_back({fft, timeConfig(fft, exponent)});
+  }
+  model.fit(samples);
+  double fitError = CostModel::looError(samples);
+  double margin = std::max(0.1, 3 * fitError);
+  log("Cost model: %s; leave-one-out error %.1f%%\n", model.describe().c_str(), fitError * 100);
+
+  // A non-positive prediction is the linear fit extrapolating badly: such a candidate is neither pruned nor prunes.
+  vector<double> predicted;
+  for (const auto& c : candidates) { predicted.push_back(model.predict(c.fft)); }
+
+  vector<TuneCandidate> kept;
+  for (u32 i = 0; i < candidates.size(); ++i) {
+    bool beaten = false;
+    for (u32 j = 0; j < candidates.size() && !beaten; ++j) {
+      beaten = j != i && predicted[j] > 0 && candidates[j].fft.maxExp() >= candidates[i].fft.maxExp()
+        && predicted[j] * (1 + margin) < predicted[i];
+    }
+    if (!beaten || isCalibration[i]) { kept.push_back(candidates[i]); }
+  }
+  log("Cost model pruned %u of %u candidates (margin %.0f%%)\n",
+      u32(candidates.size() - kept.size()), u32(candidates.size()), margin * 100);
+  return kept;
+}
+
+// Compare the cost model with the configs timed since it was fitted.
+void Tune::reportModelError() {
+  if (!model.isFitted() || measured.empty()) { return; }
+
+  double worst = 0;
+  string worstSpec;
+  for (const auto& [fft, t] : measured) {
+    double e = model.predict(fft) / t - 1;
+    if (fabs(e) > fabs(worst)) {
+      worst = e;
+      worstSpec = fft.spec();
+    }
+  }
+  log("Cost model error over %u timings: rms %.1f%%, worst %+.1f%% (%s)\n",
+      u32(measured.size()), model.rmsError(measured) * 100, worst * 100, worstSpec.c_str());
+}
+
+void Tune::sweep(const vector<TuneCandidate>& candidates, vector<TuneEntry>& results, const string& kind) {
+  for (auto [fft, exponent] : candidates) {
+    double cost = timeConfig(fft, exponent, FULL_ITERS, {}, kind);
+    measured.push_back({fft, cost});
+    bool isUseful = TuneEntry{cost, fft}.update(results);
+    log("%c %6.1f %12s %9u\n", isUseful ? '*' : ' ', cost, fft.spec().c_str(), fft.maxExp());
+  }
+}
+
+// Successive halving: time every candidate briefly, drop the ones that are clearly beaten by a faster candidate
+// that handles at least the same exponent, and re-time the survivors with twice the iterations.
+// "Clearly beaten" means the confidence intervals of the two medians do not overlap. Candidates that are beaten
+// but not clearly are re-measured (the slower half of them is dropped each round) until the intervals separate,
+// the iteration limit is reached, or the -tuneBudget time runs out.
+void Tune::race(vector<TuneCandidate> alive, vector<TuneEntry>& results) {
+  // timePRP() takes one sub-sample per 100 iterations after the first 100: 500 gives 4, enough for a MAD.
+  const u32 MIN_ITERS = 500;
+  const u32 MAX_ITERS = 8 * FULL_ITERS;
+  const double budget = shared.args->tuneBudget;
+  Timer timer;
+
+  vector<TimeStats> cost;
+  u32 iters = MIN_ITERS;
+  while (true) {
+    cost.clear();
+    for (auto [fft, exponent] : alive) {
+      cost.push_back(timeConfig(fft, exponent, iters));
+      measured.push_back({fft, cost.back()});
+    }
+
+    // The relative gap to the fastest candidate that handles at least the same exponent; <=0 means on the front.
+    vector<double> gap(alive.size());
+    vector<bool> separated(alive.size());
+    for (u32 i = 0; i < alive.size(); ++i) {
+      double best = cost[i];
+      for (u32 j = 0; j < alive.size(); ++j) {
+        if (j != i && alive[j].fft.maxExp() >= alive[i].fft.maxExp()) {
+          best = std::min(best, cost[j].median);
+          if (cost[j].median + cost[j].ci() < cost[i].median - cost[i].ci()) { separated[i] = true; }
+        }
+      }
+      gap[i] = cost[i] / best - 1;
+    }
+
+    vector<double> tiedGaps;
+    for (u32 i = 0; i < alive.size(); ++i) { if (gap[i] > 0 && !separated[i]) { tiedGaps.push_back(gap[i]); } }
+    bool outOfTime = budget > 0 && timer.at() >= budget;
+    bool done = tiedGaps.empty() || iters >= MAX_ITERS || outOfTime;
+
+    // Beyond dropping what is clearly beaten, halve the candidates that are beaten but still within noise.
+    // Not on too few sub-samples, where a single noisy one would decide.
+    bool enoughSamples = std::all_of(cost.begin(), cost.end(),
+                                     [](const TimeStats& s) { return s.n >= TimeStats::MIN_SAMPLES; });
+    double cut = 1e9;
+    if (!done && enoughSamples && tiedGaps.size() >= 2) {
+      std::nth_element(tiedGaps.begin(), tiedGaps.begin() + tiedGaps.size() / 2, tiedGaps.end());
+      cut = tiedGaps[tiedGaps.size() / 2];
+    }
+
+    vector<TuneCandidate> next;
+    for (u32 i = 0; i < alive.size(); ++i) {
+      if (!separated[i] && (gap[i] < cut || done)) { next.push_back(alive[i]); }
+    }
+    log("Race %5u iters: %3u candidates, %u tied, kept %u%s\n", iters, u32(alive.size()), u32(tiedGaps.size()),
+        u32(next.size()), outOfTime ? " (out of time)" : "");
+
+    if (done) {
+      for (u32 i = 0; i < alive.size(); ++i) {
+        if (separated[i]) { continue; }
+        FFTConfig fft = alive[i].fft;
+        bool isUseful = TuneEntry{cost[i], fft}.update(results);
+        log("%c %6.1f +- %4.1f %12s %9u%s\n", isUseful ? '*' : ' ', cost[i].median, cost[i].ci(),
+            fft.spec().c_str(), fft.maxExp(), gap[i] > 0 ? " (tie)" : "");
+      }
+      return;
+    }
+
+    alive = std::move(next);
+    iters *= 2;
+  }
+}
+
+// Report how the raced front differs from the exhaustive one, measured with the exhaustive sweep's costs.
+void Tune::compareResults(const vector<TuneEntry>& raced, const vector<TuneEntry>& full, double raceSecs, double fullSecs) {
+  log("Race took %.0fs, full sweep %.0fs (%.0f%%)\n", raceSecs, fullSecs, raceSecs / fullSecs * 100);
+
+  double worst = 0;
+  for (const TuneEntry& f : full) {
+    u32 E = f.fft.maxExp();
+    // The config the raced tune.txt would pick for E
+    auto it = std::find_if(raced.begin(), raced.end(), [E](const TuneEntry& r) { return r.fft.maxExp() >= E; });
+    if (it == raced.end()) {
+      log("%12s %9u : not covered by the race\n", f.fft.spec().c_str(), E);
+      continue;
+    }
+    if (it->fft.spec() == f.fft.spec()) { continue; }
+
+    auto fullCost = std::find_if(full.begin(), full.end(), [&](const TuneEntry& e) { return e.fft.spec() == it->fft.spec(); });
+    double loss = fullCost == full.end() ? 0 : fullCost->cost / f.cost - 1;
+    worst = std::max(worst, loss);
+    log("%12s %9u : race chose %12s (%+.1f%%)\n", f.fft.spec().c_str(), E, it->fft.spec().c_str(), loss * 100);
+  }
+  log("Race vs. full sweep: worst loss %.1f%%\n", worst * 100);
+}
+
+// The FFT sizes that may be chosen for E: the two smallest sizes that can handle it.
+vector<u32> Tune::sizesFor(const vector<FFTShape>& shapes, u32 E) const {
+  vector<u32> sizes;
+  for (const FFTShape& shape : shapes) {
+    if (FFTConfig{shape, LAST_VARIANT, CARRY_AUTO}.maxExp() * shared.args->fftOverdrive >= E) { sizes.push_back(shape.size()); }
+  }
+  std::sort(sizes.begin(), sizes.end());
+  sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+  if (sizes.size() > 2) { sizes.resize(2); }
+  return sizes;
+}
+
+void Tune::timeCandidates(const vector<TuneCandidate>& candidates, vector<TuneEntry>& results) {
+  Args *args = shared.args;
+  log("Timing %u FFT configurations\n", u32(candidates.size()));
+  Timer timer;
+  if (args->tuneMode == Args::TUNE_FULL) {
+    sweep(candidates, results);
+  } else if (args->tuneMode == Args::TUNE_RACE) {
+    race(args->tuneCostModel ? prune(candidates) : candidates, results);
+  } else {
+    assert(args->tuneMode == Args::TUNE_COMPARE);
+    vector<TuneEntry> raced = results;
+    Timer t;
+    race(args->tuneCostModel ? prune(candidates) : candidates, raced);
+    double raceSecs = t.reset();
+    // Not the "time" kind: the race times some candidates at FULL_ITERS, and the sweep must not reuse those.
+    sweep(candidates, results, "sweep");
+    double sweepSecs = t.reset();
+    compareResults(raced, results, raceSecs, sweepSecs);
+  }
+  reportModelError();
+  log("Tuning took %.0fs\n", timer.at());
+}
+
+// Time only the candidates that bestFit() could pick for the pending tasks. The candidates are grouped by the
+// tasks they could serve, and the groups are timed in order of the work they cover; tune.txt is written after each
+// group so that work can start with the most relevant FFTs already tuned.
+void Tune::tuneForWork(const vector<Task>& tasks, const vector<FFTShape>& shapes, const vector<TuneCandidate>& candidates,
+                       vector<TuneEntry>& results) {
+  // The candidates (by index) that could serve a task, and the work in the tasks they would serve.
+  map<vector<u32>, double> groups;
+
+  for (const Task& task : tasks) {
+    u32 E = task.exponent;
+    vector<u32> sizes = sizesFor(shapes, E);
+    vector<u32> group;
+    for (u32 i = 0; i < candidates.size(); ++i) {
+      FFTConfig fft = candidates[i].fft;
+      if (fft.maxExp() * shared.args->fftOverdrive >= E && std::find(sizes.begin(), sizes.end(), fft.size()) != sizes.end()) {
+        group.push_back(i);
+      }
+    }
+    if (group.empty()) {
+      log("No FFT candidate for %u\n", E);
+      continue;
+    }
+    // Iterations times the (roughly proportional to E) cost per iteration
+    double iters = task.kind == Task::CERT ? task.squarings : E;
+    groups[group] += iters * E;
+  }
+
+  vector<pair<double, vector<u32>>> byWork;
+  for (const auto& [group, work] : groups) { byWork.push_back({work, group}); }
+  std::sort(byWork.begin(), byWork.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  for (const auto& [work, group] : byWork) {
+    vector<TuneCandidate> c;
+    for (u32 i : group) { c.push_back(candidates[i]); }
+    log("Tuning %s .. %s for %.0f%% of the pending work\n", c.front().fft.spec().c_str(), c.back().fft.spec().c_str(),
+        work / std::accumulate(byWork.begin(), byWork.end(), 0.0, [](double a, const auto& b) { return a + b.first; }) * 100);
+    timeCandidates(c, results);
+    TuneEntry::writeTuneFile(results);
+  }
+}
+
 void Tune::tune() {
   Args *args = shared.args;
   vector<FFTShape> shapes = FFTShape::multiSpec(args->fftSpec);
+  const bool singleShape = shapes.size() == 1;
+
+  vector<Task> tasks;
+  if (args->tuneForWork) {
+    tasks = Worktodo::pendingTasks(*args);
+    if (tasks.empty()) {
+      log("No pending work to tune for\n");
+      return;
+    }
+
+    // Keep only the shapes of the sizes that may be chosen for some task.
+    set<u32> sizes;
+    for (const Task& task : tasks) {
+      for (u32 size : sizesFor(shapes, task.exponent)) { sizes.insert(size); }
+    }
+    std::erase_if(shapes, [&sizes](const FFTShape& shape) { return !sizes.count(shape.size()); });
+    if (shapes.empty()) {
+      log("No FFTs can handle the pending work\n");
+      return;
+    }
+    log("Tuning for %u pending tasks, %u FFT shapes\n", u32(tasks.size()), u32(shapes.size()));
+  }
 
   // There are some options and variants that are different based on GPU manufacturer
   bool AMDGPU = isAmdGpu(q->context->deviceId());
@@ -350,7 +729,7 @@ void Tune::tune() {
         for (u32 in_sizex : {8, 16, 32}) {
           shared.args->flags["IN_WG"] = to_string(in_wg);
           shared.args->flags["IN_SIZEX"] = to_string(in_sizex);
-          double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+          double cost = timeConfig(fft, exponent);
           log("Time for %12s using IN_WG=%u, IN_SIZEX=%u is %6.1f\n", fft.spec().c_str(), in_wg, in_sizex, cost);
 	  if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_in_wg = in_wg; best_in_sizex = in_sizex; }
 	}
@@ -372,7 +751,7 @@ void Tune::tune() {
         for (u32 out_sizex : {8, 16, 32}) {
           shared.args->flags["OUT_WG"] = to_string(out_wg);
           shared.args->flags["OUT_SIZEX"] = to_string(out_sizex);
-          double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+          double cost = timeConfig(fft, exponent);
           log("Time for %12s using OUT_WG=%u, OUT_SIZEX=%u is %6.1f\n", fft.spec().c_str(), out_wg, out_sizex, cost);
 	  if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_out_wg = out_wg; best_out_sizex = out_sizex; }
 	}
@@ -391,7 +770,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 fast_barrier : {0, 1}) {
         shared.args->flags["FAST_BARRIER"] = to_string(fast_barrier);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using FAST_BARRIER=%u is %6.1f\n", fft.spec().c_str(), fast_barrier, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_fast_barrier = fast_barrier; }
       }
@@ -408,7 +787,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 tail_trigs : {0, 1, 2}) {
         shared.args->flags["TAIL_TRIGS"] = to_string(tail_trigs);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using TAIL_TRIGS=%u is %6.1f\n", fft.spec().c_str(), tail_trigs, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_tail_trigs = tail_trigs; }
       }
@@ -425,7 +804,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 tail_kernels : {0, 1, 2, 3}) {
         shared.args->flags["TAIL_KERNELS"] = to_string(tail_kernels);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using TAIL_KERNELS=%u is %6.1f\n", fft.spec().c_str(), tail_kernels, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_tail_kernels = tail_kernels; }
       }
@@ -445,7 +824,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 tabmul_chain : {0, 1}) {
         shared.args->flags["TABMUL_CHAIN"] = to_string(tabmul_chain);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using TABMUL_CHAIN=%u is %6.1f\n", fft.spec().c_str(), tabmul_chain, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_tabmul_chain = tabmul_chain; }
       }
@@ -462,7 +841,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 pad : {0, 64, 128, 256, 512}) {
         shared.args->flags["PAD"] = to_string(pad);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using PAD=%u is %6.1f\n", fft.spec().c_str(), pad, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_pad = pad; }
       }
@@ -479,7 +858,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 nontemporal : {0, 1}) {
         shared.args->flags["NONTEMPORAL"] = to_string(nontemporal);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using NONTEMPORAL=%u is %6.1f\n", fft.spec().c_str(), nontemporal, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_nontemporal = nontemporal; }
       }
@@ -496,7 +875,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 unroll_w : {0, 1}) {
         shared.args->flags["UNROLL_W"] = to_string(unroll_w);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using UNROLL_W=%u is %6.1f\n", fft.spec().c_str(), unroll_w, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_unroll_w = unroll_w; }
       }
@@ -513,7 +892,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 unroll_h : {0, 1}) {
         shared.args->flags["UNROLL_H"] = to_string(unroll_h);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using UNROLL_H=%u is %6.1f\n", fft.spec().c_str(), unroll_h, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_unroll_h = unroll_h; }
       }
@@ -530,7 +909,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 zerohack_w : {0, 1}) {
         shared.args->flags["ZEROHACK_W"] = to_string(zerohack_w);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using ZEROHACK_W=%u is %6.1f\n", fft.spec().c_str(), zerohack_w, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_zerohack_w = zerohack_w; }
       }
@@ -547,7 +926,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 zerohack_h : {0, 1}) {
         shared.args->flags["ZEROHACK_H"] = to_string(zerohack_h);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using ZEROHACK_H=%u is %6.1f\n", fft.spec().c_str(), zerohack_h, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_zerohack_h = zerohack_h; }
       }
@@ -564,7 +943,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 middle_in_lds_transpose : {0, 1}) {
         shared.args->flags["MIDDLE_IN_LDS_TRANSPOSE"] = to_string(middle_in_lds_transpose);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using MIDDLE_IN_LDS_TRANSPOSE=%u is %6.1f\n", fft.spec().c_str(), middle_in_lds_transpose, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_middle_in_lds_transpose = middle_in_lds_transpose; }
       }
@@ -581,7 +960,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 middle_out_lds_transpose : {0, 1}) {
         shared.args->flags["MIDDLE_OUT_LDS_TRANSPOSE"] = to_string(middle_out_lds_transpose);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using MIDDLE_OUT_LDS_TRANSPOSE=%u is %6.1f\n", fft.spec().c_str(), middle_out_lds_transpose, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_middle_out_lds_transpose = middle_out_lds_transpose; }
       }
@@ -598,7 +977,7 @@ void Tune::tune() {
       double best_cost = -1.0;
       for (u32 biglit : {0, 1}) {
         shared.args->flags["BIGLIT"] = to_string(biglit);
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
+        double cost = timeConfig(fft, exponent);
         log("Time for %12s using BIGLIT=%u is %6.1f\n", fft.spec().c_str(), biglit, cost);
         if (best_cost < 0.0 || cost < best_cost) { best_cost = cost; best_biglit = biglit; }
       }
@@ -634,6 +1013,7 @@ skip_1K_256 = 0;
   map<int, u32> fastest_height_variants;
 
   vector<TuneEntry> results = TuneEntry::readTuneFile(*args);
+  vector<TuneCandidate> candidates;
 
   // Loop through all possible FFT shapes
   for (const FFTShape& shape : shapes) {
@@ -657,7 +1037,7 @@ skip_1K_256 = 0;
       }
 
       // If only one shape was specified on the command line, time it.  This lets the user time any shape, including non-favored ones.
-      if (shapes.size() > 1) {
+      if (!singleShape) {
 
         // Skip less-favored shapes
         if (!shape.isFavoredShape()) continue;
@@ -678,7 +1058,7 @@ skip_1K_256 = 0;
               if (w == 0 && !AMDGPU) continue;
               if (w == 0 && test.width > 1024) continue;
               FFTConfig fft{test, variant_WMH (w, 0, 1), CARRY_32};
-              cost = Gpu::make(q, primes.prevPrime(fft.maxExp()), shared, fft, {}, false)->timePRP();
+              cost = timeConfig(fft, primes.prevPrime(fft.maxExp()));
               log("Fast width search %6.1f %12s\n", cost, fft.spec().c_str());
               if (min_cost < 0.0 || cost < min_cost) { min_cost = cost; fastest_width = w; }
             }
@@ -700,7 +1080,7 @@ skip_1K_256 = 0;
               if (h == 0 && !AMDGPU) continue;
               if (h == 0 && test.height > 1024) continue;
               FFTConfig fft{test, variant_WMH (1, 0, h), CARRY_32};
-              cost = Gpu::make(q, primes.prevPrime(fft.maxExp()), shared, fft, {}, false)->timePRP();
+              cost = timeConfig(fft, primes.prevPrime(fft.maxExp()));
               log("Fast height search %6.1f %12s\n", cost, fft.spec().c_str());
               if (min_cost < 0.0 || cost < min_cost) { min_cost = cost; fastest_height = h; }
             }
@@ -727,12 +1107,15 @@ skip_1K_256 = 0;
         // Skip middle = 1, CARRY_32 if maximum exponent would be the same as middle = 0, CARRY_32
         if (variant_M(variant) > 0 && carry == CARRY_32 && fft.maxExp() <= FFTConfig{shape, variant - 10, CARRY_32}.maxExp()) continue;
 
-        double cost = Gpu::make(q, exponent, shared, fft, {}, false)->timePRP();
-        bool isUseful = TuneEntry{cost, fft}.update(results);
-        log("%c %6.1f %12s %9u\n", isUseful ? '*' : ' ', cost, fft.spec().c_str(), fft.maxExp());
+        candidates.push_back({fft, exponent});
       }
     }
   }
 
-  TuneEntry::writeTuneFile(results);
+  if (args->tuneForWork) {
+    tuneForWork(tasks, shapes, candidates, results);
+  } else {
+    timeCandidates(candidates, results);
+    TuneEntry::writeTuneFile(results);
+  }
 }
@@ -5,6 +5,8 @@
 #include "Primes.h"
 #include "GpuCommon.h"
 #include "FFTConfig.h"
+#include "TuneJournal.h"
+#include "CostModel.h"
 
 #include <array>
 #include <vector>
@@ -13,20 +15,52 @@ class Queue;
 class GpuCommon;
 class RoeInfo;
 class Gpu;
+struct TimeStats;
 
 using TuneConfig = vector<KeyVal>;
 
+class TuneEntry;
+class Task;
+
+struct TuneCandidate {
+  FFTConfig fft;
+  u32 exponent;
+};
+
 class Tune {
 private:
   Queue *q;
   GpuCommon shared;
   Primes primes;
+  TuneJournal journal;
+
+  CostModel model;
+  vector<CostModel::Sample> measured; // timings done by sweep() and race(), used to check the model
+
+  // The number of iterations timed per config by the exhaustive sweep.
+  static constexpr u32 FULL_ITERS = 1000;
 
   double maxBpw(FFTConfig fft);
   double zForBpw(double bpw, FFTConfig fft, u32);
 
+  string configKey(const TuneConfig& extra) const;
+
+  // Measurements go through the journal, thus are not repeated when tuning is resumed.
+  // A different journal *kind* keeps the timings apart, e.g. the full sweep of "-tune compare" from the race.
+  TimeStats timeConfig(FFTConfig fft, u32 exponent, u32 iters = FULL_ITERS, const TuneConfig& extra = {},
+                       const string& kind = "time");
+  void sweep(const vector<TuneCandidate>& candidates, vector<TuneEntry>& results, const string& kind = "time");
+  void race(vector<TuneCandidate> candidates, vector<TuneEntry>& results);
+  vector<TuneCandidate> prune(const vector<TuneCandidate>& candidates);
+  void reportModelError();
+  void timeCandidates(const vector<TuneCandidate>& candidates, vector<TuneEntry>& results);
+  vector<u32> sizesFor(const vector<FFTShape>& shapes, u32 E) const;
+  void tuneForWork(const vector<Task>& tasks, const vector<FFTShape>& shapes, const vector<TuneCandidate>& candidates,
+                   vector<TuneEntry>& results);
+  void compareResults(const vector<TuneEntry>& raced, const vector<TuneEntry>& full, double raceSecs, double fullSecs);
+
 public:
-  Tune(Queue *q, GpuCommon shared) : q{q}, shared{shared} {}
+  Tune(Queue *q, GpuCommon shared);
 
   // Find the max-BPW for each FFT
   void ztune();
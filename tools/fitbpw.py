@@ -0,0 +1,99 @@
+#!/usr/bin/python3
+
+# Fits the FFT BPW limits from the ROE measurements that -ztune records in tune-journal.txt.
+# For every FFT shape, variant and carry mode, Z is fitted as a linear function of bpw (weighted by the Z confidence
+# intervals), and the bpw at the target Z is reported. The shapes with all the variants of the fftbpw.h table are
+# printed in the fftbpw.h format, ready to be loaded with "prpll -bpw <file>".
+#
+# Usage: fitbpw.py [-z <targetZ>] [-device <name>] [tune-journal.txt] > fftbpw.txt
+
+import sys
+from collections import defaultdict
+
+target = 28.0
+device = None
+path = 'tune-journal.txt'
+
+args = sys.argv[1:]
+while args:
+    a = args.pop(0)
+    if a == '-z':
+        target = float(args.pop(0))
+    elif a == '-device':
+        device = args.pop(0)
+    elif a.startswith('-'):
+        print(f'Usage: {sys.argv[0]} [-z <targetZ>] [-device <name>] [tune-journal.txt]', file=sys.stderr)
+        sys.exit(1)
+    else:
+        path = a
+
+def parseInt(s):
+    mult = 1024 if s[-1] in 'kK' else 1024 * 1024 if s[-1] in 'mM' else 1
+    return int(float(s.rstrip('kKmM')) * mult)
+
+def size(shape):
+    w, m, h = (parseInt(x) for x in shape.split(':'))
+    return 2 * w * m * h
+
+# The variants of the fftbpw.h table, in order. For the 4K width, 100 and 110 replace 000 and 010.
+def tableVariants(width):
+    return ['100' if width > 1024 else '000', '101', '202', '110' if width > 1024 else '010', '111', '212']
+
+# (shape, variant, carry) -> [(bpw, z, ci)]
+points = defaultdict(list)
+
+with open(path) as f:
+    for line in f:
+        if ' : ' not in line:
+            continue
+        key, values = line.split(' : ', 1)
+        words = key.split()
+        # words[0] is <device>#<build>; the Z of every build is used
+        if len(words) < 5 or words[1] != 'roe' or (device and words[0].split('#')[0] != device):
+            continue
+        spec, E = words[2], int(words[3])
+        values = [float(x) for x in values.split()]
+        if len(values) < 2 or not values[1]:
+            continue # the check failed, the Z is not meaningful
+        parts = spec.split(':')
+        shape = ':'.join(parts[:3])
+        variant = parts[3]
+        carry = '32' if len(parts) > 4 and parts[4] == '0' else '64' # the ROE does not depend on CARRY64 vs. auto
+        ci = values[2] if len(values) > 2 and values[2] > 0 else 1.0
+        points[(shape, variant, carry)].append((E / size(shape), values[0], ci))
+
+# Weighted least squares z = a + b * bpw; returns the bpw at the target Z.
+def fit(pts):
+    ws = [1 / (ci * ci) for _, _, ci in pts]
+    sw = sum(ws)
+    mx = sum(w * x for w, (x, _, _) in zip(ws, pts)) / sw
+    my = sum(w * y for w, (_, y, _) in zip(ws, pts)) / sw
+    sxx = sum(w * (x - mx) ** 2 for w, (x, _, _) in zip(ws, pts))
+    sxy = sum(w * (x - mx) * (y - my) for w, (x, y, _) in zip(ws, pts))
+    if sxx <= 0 or sxy >= 0:
+        return None # Z must decrease with bpw
+    b = sxy / sxx
+    return mx + (target - my) / b
+
+limits = defaultdict(dict) # (shape, carry) -> {variant: bpw}
+for (shape, variant, carry), pts in sorted(points.items()):
+    if len(set(x for x, _, _ in pts)) < 2:
+        print(f'// {shape}:{variant} carry {carry}: need Z at two bpw at least', file=sys.stderr)
+        continue
+    bpw = fit(pts)
+    if bpw is None:
+        print(f'// {shape}:{variant} carry {carry}: Z does not decrease with bpw', file=sys.stderr)
+        continue
+    print(f'// {shape}:{variant} carry {carry}: bpw {bpw:.3f} at Z={target} from {len(pts)} points', file=sys.stderr)
+    limits[(shape, carry)][variant] = bpw
+
+print(f'// BPW limits at Z={target} fitted from {path}')
+for (shape, carry), byVariant in sorted(limits.items(), key=lambda kv: (size(kv[0][0]), kv[0])):
+    if carry == '32':
+        continue # CARRY32 is capped separately, by carry32BPW()
+    want = tableVariants(parseInt(shape.split(':')[0]))
+    if not all(v in byVariant for v in want):
+        missing = ' '.join(v for v in want if v not in byVariant)
+        print(f'// {shape} (carry {carry}): missing variants {missing}')
+        continue
+    print('{%12s, {%s}},' % (f'"{shape}"', ', '.join(f'{byVariant[v]:.3f}' for v in want)))
@@ -0,0 +1,65 @@
+// Copyright (C) Mihai Preda
+
+// Contended throughput and worst-case caller latency of log().
+// N threads each log M lines as fast as they can; reports the lines/s and the longest single log() call.
+// With -sync, the same through a global mutex and a direct write to stdout (the logger before the rings), for
+// comparison. The lines go to stdout, so redirect it, e.g.:
+//   g++ -O2 -std=c++20 -Isrc tools/logbench.cpp src/log.cpp src/File.cpp src/timeutil.cpp -o logbench -pthread
+//   ./logbench 16 20000 > /tmp/out.txt; grep -c "" /tmp/out.txt
+//   ./logbench 4 2000 | (sleep 2; cat > /dev/null)     # a stalled reader
+// Lines dropped by full rings are reported in the output as "log: dropped N lines".
+
+#include "log.h"
+#include "common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <threads> <lines per thread> [-sync]\n", argv[0]);
+    return 1;
+  }
+  unsigned nThreads = atoi(argv[1]);
+  unsigned nLines = atoi(argv[2]);
+  bool isSync = argc > 3 && !strcmp(argv[3], "-sync");
+
+  std::mutex syncMutex;
+  std::atomic<u64> worstNs{};
+  auto start = steady_clock::now();
+
+  std::vector<std::jthread> threads;
+  for (unsigned t = 0; t < nThreads; ++t) {
+    threads.emplace_back([&, t] {
+      u64 worst = 0;
+      char buf[128];
+      for (unsigned i = 0; i < nLines; ++i) {
+        auto t0 = steady_clock::now();
+        if (isSync) {
+          snprintf(buf, sizeof(buf), "%s thread %u line %u\n", shortTimeStr().c_str(), t, i);
+          std::lock_guard lock{syncMutex};
+          fputs(buf, stdout);
+        } else {
+          log("thread %u line %u\n", t, i);
+        }
+        worst = std::max<u64>(worst, duration_cast<nanoseconds>(steady_clock::now() - t0).count());
+      }
+      u64 old = worstNs;
+      while (old < worst && !worstNs.compare_exchange_weak(old, worst)) {}
+    });
+  }
+  threads.clear();
+
+  double secs = duration<double>(steady_clock::now() - start).count();
+  fprintf(stderr, "%s: %u threads x %u lines in %.3fs: %.0f lines/s, worst log() call %.3f ms\n",
+          isSync ? "sync" : "rings", nThreads, nLines, secs, nThreads * nLines / secs, worstNs * 1e-6);
+}